@@ -1,44 +1,78 @@
 // Example 1: Lock-based Thread Pool
 // Demonstrates basic thread pool with mutex-protected queue
-// Topics: std::thread, std::mutex, std::condition_variable, std::queue
+// Topics: std::thread, std::mutex, std::condition_variable, std::queue, CPU affinity, priority lanes
 
 #include <iostream>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <array>
 #include <functional>
 #include <vector>
 #include <chrono>
 #include <sstream>
+#include <stdexcept>
+#include <string>
 
-class ThreadPool {
+#include "bench_harness.h"
+#include "inline_task.h"
+#include "task_priority.h"
+#include "topology.h"
+
+// Task is the stored callable: std::function<void()>, or a move-only
+// InlineTask<N> that keeps the capture inline and never allocates.
+// One queue per TaskPriority; workers pick the next one through a
+// LaneSelector (see task_priority.h), all under the same lock.
+template<typename Task>
+class BasicThreadPool {
 private:
     std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
+    std::array<std::queue<Task>, kPriorityLanes> lanes;
+    LaneSelector selector; // Guarded by queue_mutex
+    size_t queued = 0;     // Tasks in all lanes, guarded by queue_mutex
     std::mutex queue_mutex;
     std::condition_variable condition;
+    std::condition_variable idle;
+    size_t pending = 0; // Enqueued but not yet finished, guarded by queue_mutex
     bool stop = false;
 
 public:
-    ThreadPool(size_t threads) {
+    // pinning != None pins each worker (see topology.h); with one shared
+    // queue there are no per-worker buffers to place, only the threads.
+    // log_workers = false silences the start / stop lines (benchmarks).
+    BasicThreadPool(size_t threads, ThreadPinning pinning = ThreadPinning::None, bool log_workers = true,
+                    const LanePolicy& lane_policy = {})
+        : selector(lane_policy) {
+        const std::vector<WorkerPlacement> plan = plan_workers(threads, pinning);
         for (size_t i = 0; i < threads; ++i) {
-            workers.emplace_back([this, i] {
-                {
+            workers.emplace_back([this, i, pinning, log_workers, placement = plan[i]] {
+                if (!log_workers) {
+                    apply_placement(placement, pinning);
+                } else {
                     std::stringstream ss;
-                    ss << "Worker " << i << " started\n";
+                    ss << "Worker " << i << " started";
+                    if (pinning != ThreadPinning::None) {
+                        bool pinned = apply_placement(placement, pinning);
+                        ss << " (node " << placement.node;
+                        if (placement.cpu >= 0) {
+                            ss << ", cpu " << placement.cpu;
+                        }
+                        ss << (pinned ? ")" : ", not pinned)");
+                    }
+                    ss << "\n";
                     std::cout << ss.str() << std::flush;
                 }
                 while (true) {
-                    std::function<void()> task;
+                    Task task;
                     {
                         std::unique_lock<std::mutex> lock(queue_mutex);
                         condition.wait(lock, [this] { 
-                            return stop || !tasks.empty(); 
+                            return stop || queued > 0; 
                         });
                         
-                        if (stop && tasks.empty()) {
-                            {
+                        if (stop && queued == 0) {
+                            if (log_workers) {
                                 std::stringstream ss;
                                 ss << "Worker " << i << " stopping\n";
                                 std::cout << ss.str() << std::flush;
@@ -46,10 +80,23 @@ public:
                             return;
                         }
                         
-                        task = std::move(tasks.front());
-                        tasks.pop();
+                        selector.next([&](size_t lane) {
+                            if (lanes[lane].empty()) {
+                                return false;
+                            }
+                            task = std::move(lanes[lane].front());
+                            lanes[lane].pop();
+                            return true;
+                        });
+                        --queued;
                     }
                     task(); // Execute outside the lock
+                    {
+                        std::unique_lock<std::mutex> lock(queue_mutex);
+                        if (--pending == 0) {
+                            idle.notify_all();
+                        }
+                    }
                 }
             });
         }
@@ -57,17 +104,30 @@ public:
 
     template<class F>
     void enqueue(F&& f) {
+        enqueue(TaskPriority::Normal, std::forward<F>(f));
+    }
+
+    template<class F>
+    void enqueue(TaskPriority priority, F&& f) {
         {
             std::unique_lock<std::mutex> lock(queue_mutex);
             if (stop) {
                 throw std::runtime_error("enqueue on stopped ThreadPool");
             }
-            tasks.emplace(std::forward<F>(f));
+            lanes[lane_of(priority)].emplace(std::forward<F>(f));
+            ++queued;
+            ++pending;
         }
         condition.notify_one();
     }
 
-    ~ThreadPool() {
+    // Block until every enqueued task has finished
+    void wait_idle() {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        idle.wait(lock, [this] { return pending == 0; });
+    }
+
+    ~BasicThreadPool() {
         {
             std::unique_lock<std::mutex> lock(queue_mutex);
             stop = true;
@@ -79,6 +139,8 @@ public:
     }
 };
 
+using ThreadPool = BasicThreadPool<InlineTask<>>;
+
 // Example usage
 void cpu_intensive_task(int id, int duration_ms) {
     {
@@ -94,15 +156,51 @@ void cpu_intensive_task(int id, int duration_ms) {
     }
 }
 
-int main() {
+// --bench-json: producers submit workload.ops tasks of task_ns busy work
+// to a pool of workload.consumers workers; latency is submit -> task start
+template<typename Pool>
+void measure_pool(BenchReport& report, const char* variant) {
+    const Workload& load = report.workload();
+    report.measure("ThreadPool", variant, [&load](TrialTimer& timer, LatencyRecorder& latency) {
+        Pool pool(load.consumers, ThreadPinning::None, false);
+        timer.start();
+        std::vector<std::thread> producers;
+        for (size_t p = 0; p < load.producers; ++p) {
+            producers.emplace_back([&, p] {
+                for (uint64_t i = share_of(load.ops, load.producers, p); i > 0; --i) {
+                    pool.enqueue([&latency, work = load.task_ns, submitted = latency_now()] {
+                        latency.record(latency_now() - submitted);
+                        busy_work(work);
+                    });
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        pool.wait_idle();
+        timer.stop();
+    });
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--bench-json") {
+        return run_bench_json(argc, argv, 2, "01_thread_pool_lock_based", [](BenchReport& report) {
+            measure_pool<ThreadPool>(report, "InlineTask<64>");
+            measure_pool<BasicThreadPool<std::function<void()>>>(report, "std::function");
+        });
+    }
+
     {
         std::stringstream ss;
         ss << "=== Lock-based Thread Pool Example ===\n";
-        ss << "Hardware concurrency: " << std::thread::hardware_concurrency() << "\n\n";
+        ss << "Hardware concurrency: " << std::thread::hardware_concurrency() << "\n";
+        ss << "Topology: " << Topology::get().describe() << "\n\n";
         std::cout << ss.str() << std::flush;
     }
 
-    ThreadPool pool(4);
+    // One worker per core, so the scheduler cannot migrate them mid-task
+    ThreadPool pool(4, ThreadPinning::Core);
 
     // Enqueue 10 tasks
     for (int i = 0; i < 10; ++i) {
@@ -116,10 +214,27 @@ int main() {
         ss << "\nAll tasks enqueued. Waiting for completion...\n";
         std::cout << ss.str() << std::flush;
     }
-    std::this_thread::sleep_for(std::chrono::seconds(2));
+    pool.wait_idle();
+
+    // Priority lanes: the critical task is queued last but starts as soon
+    // as a worker frees up, ahead of the bulk tasks still waiting
+    {
+        std::stringstream ss;
+        ss << "\nQueueing 12 bulk tasks, then 1 critical task...\n";
+        std::cout << ss.str() << std::flush;
+    }
+    for (int i = 0; i < 12; ++i) {
+        pool.enqueue(TaskPriority::Bulk, [i] {
+            cpu_intensive_task(100 + i, 50);
+        });
+    }
+    pool.enqueue(TaskPriority::Critical, [] {
+        cpu_intensive_task(999, 10);
+    });
+    pool.wait_idle();
     {
         std::stringstream ss;
-        ss << "\nMain thread exiting (pool destructor will wait for workers)\n";
+        ss << "\nAll tasks completed. Main thread exiting (pool destructor joins the workers)\n";
         std::cout << ss.str() << std::flush;
     }
 
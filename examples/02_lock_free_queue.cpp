@@ -1,6 +1,7 @@
 // Example 2: Lock-free Queue using std::atomic
 // Demonstrates Compare-And-Swap (CAS) operations and memory ordering
-// Topics: std::atomic, compare_exchange_weak, memory_order
+// Topics: std::atomic, compare_exchange_weak, memory_order,
+//         safe memory reclamation (hazard pointers, epochs)
 
 #include <atomic>
 #include <memory>
@@ -8,82 +9,415 @@
 #include <thread>
 #include <vector>
 #include <sstream>
+#include <string>
+#include <mutex>
+#include <algorithm>
+#include <stdexcept>
+#include <chrono>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include "bench_harness.h"
+#include "node_arena.h"
 
-template<typename T>
+// Reclamation policies
+// A lock-free structure can't free a node the moment it unlinks it: another
+// thread may have loaded the pointer just before and still be reading it.
+// A policy provides:
+//   typename R::Guard guard;               covers one queue operation
+//   Node* p = guard.protect(i, atomic_ptr) load that stays safe to dereference
+//                                          while the guard lives (slot i < 2)
+//   R::retire(p, deleter)                  run deleter(p) once no guard can
+//                                          still reach p
+struct RetiredNode {
+    void* pointer;
+    void (*deleter)(void*);
+};
+
+constexpr size_t kMaxReclaimerThreads = 128;
+constexpr size_t kHazardSlots = 2;
+
+// Per-thread published state, one cache line each
+struct alignas(64) HazardRecord {
+    std::atomic<bool> owned{false};
+    std::atomic<void*> hazards[kHazardSlots] = {};
+};
+
+struct alignas(64) EpochRecord {
+    std::atomic<bool> owned{false};
+    std::atomic<uint64_t> state{0}; // 0 = quiescent, else (epoch << 1) | 1
+};
+
+// Hazard pointers: each thread publishes the (at most two) nodes it is about
+// to dereference. Retired nodes are freed by scanning all published hazards.
+// Memory held back is bounded by threads * slots.
+class HazardPointerReclaimer {
+private:
+    static constexpr size_t kScanThreshold = 2 * kMaxReclaimerThreads * kHazardSlots;
+
+    using Record = HazardRecord;
+
+    static inline Record records[kMaxReclaimerThreads];
+    static inline std::mutex orphans_mutex;
+    static inline std::vector<RetiredNode> orphans; // Left behind by exited threads
+
+    struct Local {
+        Record* record = nullptr;
+        std::vector<RetiredNode> retired;
+
+        Local() {
+            for (auto& candidate : records) {
+                bool expected = false;
+                if (!candidate.owned.load(std::memory_order_relaxed) &&
+                    candidate.owned.compare_exchange_strong(expected, true)) {
+                    record = &candidate;
+                    return;
+                }
+            }
+            throw std::runtime_error("HazardPointerReclaimer: too many threads");
+        }
+
+        ~Local() {
+            scan();
+            if (!retired.empty()) {
+                std::lock_guard<std::mutex> lock(orphans_mutex);
+                orphans.insert(orphans.end(), retired.begin(), retired.end());
+            }
+            record->owned.store(false, std::memory_order_release);
+        }
+
+        void scan() {
+            {
+                std::unique_lock<std::mutex> lock(orphans_mutex, std::try_to_lock);
+                if (lock.owns_lock() && !orphans.empty()) {
+                    retired.insert(retired.end(), orphans.begin(), orphans.end());
+                    orphans.clear();
+                }
+            }
+
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::vector<void*> protected_nodes;
+            for (auto& r : records) {
+                for (auto& hazard : r.hazards) {
+                    if (void* p = hazard.load(std::memory_order_acquire)) {
+                        protected_nodes.push_back(p);
+                    }
+                }
+            }
+            std::sort(protected_nodes.begin(), protected_nodes.end());
+
+            auto still_protected = std::partition(retired.begin(), retired.end(),
+                [&protected_nodes](const RetiredNode& node) {
+                    return std::binary_search(protected_nodes.begin(), protected_nodes.end(),
+                                              node.pointer);
+                });
+            for (auto it = still_protected; it != retired.end(); ++it) {
+                it->deleter(it->pointer);
+            }
+            retired.erase(still_protected, retired.end());
+        }
+    };
+
+    static Local& local() {
+        thread_local Local instance;
+        return instance;
+    }
+
+public:
+    class Guard {
+    private:
+        Record* record;
+
+    public:
+        Guard() : record(local().record) {}
+
+        ~Guard() {
+            for (auto& hazard : record->hazards) {
+                hazard.store(nullptr, std::memory_order_release);
+            }
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        template<typename Node>
+        Node* protect(size_t slot, const std::atomic<Node*>& source) {
+            Node* p = source.load(std::memory_order_acquire);
+            while (true) {
+                record->hazards[slot].store(p, std::memory_order_seq_cst);
+                // Re-read: the node was still reachable after we published it,
+                // so any later retire() will see our hazard
+                Node* again = source.load(std::memory_order_acquire);
+                if (again == p) {
+                    return p;
+                }
+                p = again;
+            }
+        }
+    };
+
+    static void retire(void* pointer, void (*deleter)(void*)) {
+        Local& l = local();
+        l.retired.push_back({pointer, deleter});
+        if (l.retired.size() >= kScanThreshold) {
+            l.scan();
+        }
+    }
+};
+
+// Epoch-based reclamation: a guard pins the current global epoch. The epoch
+// only advances once every pinned thread has caught up, and a node retired in
+// epoch e is freed once the epoch reaches e + 2. Cheaper than hazard pointers
+// (no per-load fence), but one stalled thread holds back all reclamation.
+class EpochReclaimer {
+private:
+    static constexpr uint64_t kAdvanceInterval = 64; // Retires between advance attempts
+
+    using Record = EpochRecord;
+
+    static inline std::atomic<uint64_t> global_epoch{1};
+    static inline Record records[kMaxReclaimerThreads];
+    static inline std::mutex orphans_mutex;
+    static inline std::vector<RetiredNode> orphans;
+
+    struct Local {
+        Record* record = nullptr;
+        size_t depth = 0; // Nested guards
+        std::vector<RetiredNode> limbo[3];
+        uint64_t limbo_epoch[3] = {0, 0, 0};
+        uint64_t retire_count = 0;
+
+        Local() {
+            for (auto& candidate : records) {
+                bool expected = false;
+                if (!candidate.owned.load(std::memory_order_relaxed) &&
+                    candidate.owned.compare_exchange_strong(expected, true)) {
+                    record = &candidate;
+                    return;
+                }
+            }
+            throw std::runtime_error("EpochReclaimer: too many threads");
+        }
+
+        ~Local() {
+            std::lock_guard<std::mutex> lock(orphans_mutex);
+            for (auto& bucket : limbo) {
+                orphans.insert(orphans.end(), bucket.begin(), bucket.end());
+            }
+            record->owned.store(false, std::memory_order_release);
+        }
+
+        static void free_all(std::vector<RetiredNode>& bucket) {
+            for (auto& node : bucket) {
+                node.deleter(node.pointer);
+            }
+            bucket.clear();
+        }
+    };
+
+    static Local& local() {
+        thread_local Local instance;
+        return instance;
+    }
+
+    static bool try_advance(uint64_t epoch) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (auto& r : records) {
+            uint64_t state = r.state.load(std::memory_order_acquire);
+            if ((state & 1) && (state >> 1) != epoch) {
+                return false; // Someone is still pinned in an older epoch
+            }
+        }
+        return global_epoch.compare_exchange_strong(epoch, epoch + 1);
+    }
+
+public:
+    class Guard {
+    private:
+        Local& l;
+
+    public:
+        Guard() : l(local()) {
+            if (l.depth++ == 0) {
+                uint64_t epoch = global_epoch.load(std::memory_order_relaxed);
+                while (true) {
+                    l.record->state.store((epoch << 1) | 1, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    uint64_t current = global_epoch.load(std::memory_order_relaxed);
+                    if (current == epoch) {
+                        break;
+                    }
+                    epoch = current;
+                }
+            }
+        }
+
+        ~Guard() {
+            if (--l.depth == 0) {
+                l.record->state.store(0, std::memory_order_release);
+            }
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        template<typename Node>
+        Node* protect(size_t, const std::atomic<Node*>& source) {
+            return source.load(std::memory_order_acquire);
+        }
+    };
+
+    static void retire(void* pointer, void (*deleter)(void*)) {
+        Local& l = local();
+        uint64_t epoch = global_epoch.load(std::memory_order_acquire);
+        size_t bucket = epoch % 3;
+        if (l.limbo_epoch[bucket] != epoch) {
+            // This bucket was filled in epoch - 3 or earlier: safe to free
+            Local::free_all(l.limbo[bucket]);
+            l.limbo_epoch[bucket] = epoch;
+            std::unique_lock<std::mutex> lock(orphans_mutex, std::try_to_lock);
+            if (lock.owns_lock() && !orphans.empty()) {
+                // Orphans from exited threads join the newest bucket
+                l.limbo[bucket].insert(l.limbo[bucket].end(), orphans.begin(), orphans.end());
+                orphans.clear();
+            }
+        }
+        l.limbo[bucket].push_back({pointer, deleter});
+
+        if (++l.retire_count % kAdvanceInterval == 0) {
+            try_advance(epoch);
+        }
+    }
+};
+
+// Michael-Scott lock-free queue, safe with any number of producers and
+// consumers. Unlinked nodes go through the Reclaimer; node memory comes from
+// the Allocator policy (NodeArena or HeapAllocator, see node_arena.h).
+template<typename T, typename Reclaimer = HazardPointerReclaimer, typename Allocator = NodeArena>
 class LockFreeQueue {
 private:
+    // The value lives inline in the node. Only the node after head (the
+    // next one to be dequeued) onwards hold a constructed value; the dummy
+    // at head never does.
     struct Node {
-        std::shared_ptr<T> data;
-        std::atomic<Node*> next;
-        
-        Node() : next(nullptr) {}
-        explicit Node(T value) 
-            : data(std::make_shared<T>(std::move(value))), next(nullptr) {}
+        std::atomic<Node*> next{nullptr};
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
     };
 
-    std::atomic<Node*> head;
-    std::atomic<Node*> tail;
+    static void recycle(void* node) {
+        Allocator::destroy(static_cast<Node*>(node));
+    }
+
+    alignas(64) std::atomic<Node*> head;
+    alignas(64) std::atomic<Node*> tail;
+
+    // Unlinks the front node and hands its value to sink while the node is
+    // still protected
+    template<typename Sink>
+    bool pop(Sink&& sink) {
+        typename Reclaimer::Guard guard;
+        
+        while (true) {
+            Node* old_head = guard.protect(0, head);
+            Node* next = guard.protect(1, old_head->next);
+            if (old_head != head.load(std::memory_order_acquire)) {
+                continue; // old_head was dequeued meanwhile; next may be stale
+            }
+            if (next == nullptr) {
+                return false; // Queue is empty
+            }
+
+            Node* old_tail = tail.load(std::memory_order_acquire);
+            if (old_head == old_tail) {
+                // Tail still points at the node we'd retire: move it first
+                tail.compare_exchange_weak(old_tail, next,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed);
+                continue;
+            }
+            
+            if (head.compare_exchange_weak(
+                old_head, next,
+                std::memory_order_acq_rel,
+                std::memory_order_relaxed)) {
+                // next is the new dummy; only the winner of the CAS takes its value
+                T* value = next->value();
+                sink(std::move(*value));
+                value->~T();
+                Reclaimer::retire(old_head, &recycle);
+                return true;
+            }
+        }
+    }
 
 public:
     LockFreeQueue() {
-        Node* dummy = new Node();
+        Node* dummy = Allocator::template create<Node>();
         head.store(dummy, std::memory_order_relaxed);
         tail.store(dummy, std::memory_order_relaxed);
     }
 
+    // Requires that no other thread is still using the queue
     ~LockFreeQueue() {
-        while (Node* old_head = head.load(std::memory_order_relaxed)) {
-            head.store(old_head->next.load(std::memory_order_relaxed), 
-                      std::memory_order_relaxed);
-            delete old_head;
+        Node* node = head.load(std::memory_order_relaxed);
+        Node* next = node->next.load(std::memory_order_relaxed);
+        Allocator::destroy(node);
+        while ((node = next) != nullptr) {
+            next = node->next.load(std::memory_order_relaxed);
+            node->value()->~T();
+            Allocator::destroy(node);
         }
     }
 
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
     void enqueue(T value) {
-        Node* new_node = new Node(std::move(value));
-        Node* old_tail = tail.load(std::memory_order_acquire);
+        Node* new_node = Allocator::template create<Node>();
+        ::new (static_cast<void*>(new_node->storage)) T(std::move(value));
+        typename Reclaimer::Guard guard;
         
-        // Try to set tail->next to new_node
         while (true) {
-            Node* null_ptr = nullptr;
+            Node* old_tail = guard.protect(0, tail);
+            Node* next = old_tail->next.load(std::memory_order_acquire);
+            if (next != nullptr) {
+                // Tail is lagging behind: help swing it forward and retry
+                tail.compare_exchange_weak(old_tail, next,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed);
+                continue;
+            }
+
+            // Try to set tail->next to new_node
             if (old_tail->next.compare_exchange_weak(
-                null_ptr, new_node,
+                next, new_node,
                 std::memory_order_release,
-                std::memory_order_acquire)) {
-                break;
+                std::memory_order_relaxed)) {
+                // Try to swing tail to new_node (someone may have helped already)
+                tail.compare_exchange_strong(old_tail, new_node,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed);
+                return;
             }
-            // Someone else added a node, swing tail forward
-            old_tail = old_tail->next.load(std::memory_order_acquire);
         }
-        
-        // Try to swing tail to new_node
-        tail.compare_exchange_strong(old_tail, new_node,
-                                     std::memory_order_release,
-                                     std::memory_order_acquire);
+    }
+
+    // Allocation-free dequeue: moves the front value into out
+    bool try_dequeue(T& out) {
+        return pop([&out](T&& value) { out = std::move(value); });
     }
 
     std::shared_ptr<T> dequeue() {
-        Node* old_head = head.load(std::memory_order_acquire);
-        
-        while (true) {
-            Node* next = old_head->next.load(std::memory_order_acquire);
-            if (next == nullptr) {
-                return nullptr; // Queue is empty
-            }
-            
-            if (head.compare_exchange_weak(
-                old_head, next,
-                std::memory_order_release,
-                std::memory_order_acquire)) {
-                std::shared_ptr<T> result = next->data;
-                delete old_head;
-                return result;
-            }
-        }
+        std::shared_ptr<T> result;
+        pop([&result](T&& value) { result = std::make_shared<T>(std::move(value)); });
+        return result;
     }
 
     bool empty() const {
-        Node* h = head.load(std::memory_order_acquire);
+        typename Reclaimer::Guard guard;
+        Node* h = guard.protect(0, head);
         Node* n = h->next.load(std::memory_order_acquire);
         return n == nullptr;
     }
@@ -120,7 +454,140 @@ void consumer(LockFreeQueue<int>& queue, int id, int expected_count) {
     }
 }
 
-int main() {
+// Stress + throughput: P producers and P consumers hammer one queue. Every
+// value must come out exactly once, and in order per producer.
+template<typename Reclaimer, typename Allocator>
+void run_stress(const char* name, int pairs, int items_per_producer) {
+    LockFreeQueue<uint64_t, Reclaimer, Allocator> queue;
+    const uint64_t total = static_cast<uint64_t>(pairs) * items_per_producer;
+    std::atomic<uint64_t> consumed{0};
+    std::atomic<uint64_t> checksum{0};
+    std::atomic<bool> order_ok{true};
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int p = 0; p < pairs; ++p) {
+        threads.emplace_back([&queue, p, items_per_producer] {
+            for (int i = 0; i < items_per_producer; ++i) {
+                queue.enqueue((static_cast<uint64_t>(p) << 32) | static_cast<uint64_t>(i));
+            }
+        });
+    }
+    for (int c = 0; c < pairs; ++c) {
+        threads.emplace_back([&, pairs] {
+            std::vector<int64_t> last(pairs, -1);
+            uint64_t local_sum = 0;
+            while (consumed.load(std::memory_order_relaxed) < total) {
+                uint64_t value;
+                if (!queue.try_dequeue(value)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                int producer = static_cast<int>(value >> 32);
+                int64_t seq = static_cast<int64_t>(value & 0xffffffffu);
+                if (seq <= last[producer]) {
+                    order_ok.store(false, std::memory_order_relaxed);
+                }
+                last[producer] = seq;
+                local_sum += value;
+                consumed.fetch_add(1, std::memory_order_relaxed);
+            }
+            checksum.fetch_add(local_sum, std::memory_order_relaxed);
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t expected = 0;
+    for (int p = 0; p < pairs; ++p) {
+        for (int i = 0; i < items_per_producer; ++i) {
+            expected += (static_cast<uint64_t>(p) << 32) | static_cast<uint64_t>(i);
+        }
+    }
+    bool ok = checksum.load() == expected && consumed.load() == total && order_ok.load();
+
+    std::stringstream ss;
+    ss << "  " << name << "  threads=" << (2 * pairs)
+       << "  " << static_cast<uint64_t>(2 * total / seconds / 1000) << "k ops/s"
+       << "  " << (ok ? "OK" : "FAILED") << "\n";
+    std::cout << ss.str() << std::flush;
+    if (!ok) {
+        throw std::runtime_error("lock-free queue stress test failed");
+    }
+}
+
+void run_benchmark() {
+    std::cout << "=== LockFreeQueue reclamation benchmark ===\n"
+              << "(hardware threads: " << std::thread::hardware_concurrency() << ")\n";
+    const int items_per_producer = 20000;
+    for (int pairs : {1, 2, 4, 8, 16}) {
+        run_stress<HazardPointerReclaimer, NodeArena>("hazard pointers + arena", pairs, items_per_producer);
+        run_stress<HazardPointerReclaimer, HeapAllocator>("hazard pointers + heap ", pairs, items_per_producer);
+        run_stress<EpochReclaimer, NodeArena>("epochs + arena         ", pairs, items_per_producer);
+        run_stress<EpochReclaimer, HeapAllocator>("epochs + heap          ", pairs, items_per_producer);
+    }
+}
+
+// --bench-json: producers enqueue workload.ops items of event_bytes,
+// consumers dequeue them and do task_ns of work each; latency is
+// enqueue -> dequeue
+template<typename Reclaimer, typename Allocator>
+void measure_queue(BenchReport& report, const char* variant) {
+    const Workload& load = report.workload();
+    with_event_size(load.event_bytes, [&](auto bytes) {
+        using Item = BenchPayload<decltype(bytes)::value>;
+        report.measure("LockFreeQueue", variant, [&load](TrialTimer& timer, LatencyRecorder& latency) {
+            LockFreeQueue<Item, Reclaimer, Allocator> queue;
+            std::atomic<uint64_t> consumed{0};
+            timer.start();
+            std::vector<std::thread> threads;
+            for (size_t p = 0; p < load.producers; ++p) {
+                threads.emplace_back([&, p] {
+                    Item item{};
+                    for (uint64_t i = share_of(load.ops, load.producers, p); i > 0; --i) {
+                        item.sent_ns = latency_now();
+                        queue.enqueue(item);
+                    }
+                });
+            }
+            for (size_t c = 0; c < load.consumers; ++c) {
+                threads.emplace_back([&] {
+                    Item item;
+                    while (consumed.load(std::memory_order_relaxed) < load.ops) {
+                        if (!queue.try_dequeue(item)) {
+                            std::this_thread::yield();
+                            continue;
+                        }
+                        latency.record(latency_now() - item.sent_ns);
+                        busy_work(load.task_ns);
+                        consumed.fetch_add(1, std::memory_order_relaxed);
+                    }
+                });
+            }
+            for (auto& t : threads) {
+                t.join();
+            }
+            timer.stop();
+        });
+    });
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        run_benchmark();
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-json") {
+        return run_bench_json(argc, argv, 2, "02_lock_free_queue", [](BenchReport& report) {
+            measure_queue<HazardPointerReclaimer, NodeArena>(report, "hazard pointers + arena");
+            measure_queue<HazardPointerReclaimer, HeapAllocator>(report, "hazard pointers + heap");
+            measure_queue<EpochReclaimer, NodeArena>(report, "epochs + arena");
+            measure_queue<EpochReclaimer, HeapAllocator>(report, "epochs + heap");
+        });
+    }
+
     {
         std::stringstream ss;
         ss << "=== Lock-Free Queue Example ===\n\n";
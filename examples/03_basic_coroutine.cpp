@@ -1,16 +1,25 @@
 // Example 3: Basic Coroutine Example
 // Demonstrates C++20 coroutines with co_await, co_return
-// Topics: std::coroutine_handle, promise_type, suspend_always
+// Topics: std::coroutine_handle, promise_type, suspend_always, frame allocation
 
 #include <coroutine>
+#include <cstddef>
+#include <exception>
 #include <iostream>
+#include <memory>
+#include <new>
 #include <string>
 #include <sstream>
+#include <utility>
+
+#include "coroutine_frame_pool.h"
 
 // Simple Task coroutine type
+// Frames come from CoroutineFramePool (see PooledCoroutineFrame) instead of
+// a malloc per call
 template<typename T>
 struct Task {
-    struct promise_type {
+    struct promise_type : PooledCoroutineFrame {
         T value;
         std::exception_ptr exception;
 
@@ -137,6 +146,40 @@ Task<std::string> string_coroutine() {
     co_return local_data + " (returned)";
 }
 
+// Runs to completion straight away (initial_suspend is suspend_never)
+Task<int> square(int x) {
+    co_return x * x;
+}
+
+// Bump allocator over a caller-owned buffer, for the allocator_arg
+// overload: frames live wherever the caller puts the buffer and are
+// released all at once when it goes away
+class FrameBuffer {
+private:
+    alignas(std::max_align_t) unsigned char storage[4096];
+    size_t used = 0;
+
+public:
+    void* allocate(size_t bytes) {
+        size_t start = (used + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+        if (start + bytes > sizeof(storage)) {
+            throw std::bad_alloc();
+        }
+        used = start + bytes;
+        return storage + start;
+    }
+
+    void deallocate(void*, size_t) noexcept {}
+
+    size_t bytes_used() const {
+        return used;
+    }
+};
+
+Task<int> multiply_in(std::allocator_arg_t, FrameBuffer&, int a, int b) {
+    co_return a * b;
+}
+
 int main() {
     {
         std::stringstream ss;
@@ -176,7 +219,34 @@ int main() {
     std::string str_result = task2.get();
     {
         std::stringstream ss;
-        ss << "Result: " << str_result << "\n";
+        ss << "Result: " << str_result << "\n\n";
+        std::cout << ss.str() << std::flush;
+    }
+    
+    {
+        std::stringstream ss;
+        ss << "--- Example 3: Recycled Coroutine Frames ---\n";
+        std::cout << ss.str() << std::flush;
+    }
+    CoroutineFramePool::Stats before = CoroutineFramePool::stats();
+    long sum = 0;
+    for (int i = 0; i < 1000; ++i) {
+        sum += square(i).get(); // Each frame goes back to the pool right away
+    }
+    CoroutineFramePool::Stats after = CoroutineFramePool::stats();
+    {
+        std::stringstream ss;
+        ss << "1000 coroutines (sum " << sum << "): " << after.hits - before.hits
+           << " frames reused, " << after.misses - before.misses << " from operator new\n";
+        std::cout << ss.str() << std::flush;
+    }
+    
+    FrameBuffer buffer;
+    auto task3 = multiply_in(std::allocator_arg, buffer, 6, 7);
+    {
+        std::stringstream ss;
+        ss << "With a caller-provided allocator: " << task3.get() << " (frame took "
+           << buffer.bytes_used() << " bytes of the caller's buffer)\n";
         std::cout << ss.str() << std::flush;
     }
     
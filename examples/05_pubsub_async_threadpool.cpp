@@ -10,33 +10,71 @@
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <array>
 #include <chrono>
+#include <string>
+#include <type_traits>
+#include <atomic>
+#include <stdexcept>
+
+#include "bench_harness.h"
+#include "inline_task.h"
+#include "symbol_table.h"
+#include "event_envelope.h"
+#include "rcu_snapshot.h"
+#include "sharded_counter.h"
+#include "task_priority.h"
+#include "topology.h"
 
 // Simple Thread Pool (reused from earlier examples)
-class ThreadPool {
+// Templated on the stored task type, with one queue per TaskPriority; see example 01
+template<typename Task>
+class BasicThreadPool {
 private:
     std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
+    std::array<std::queue<Task>, kPriorityLanes> lanes;
+    LaneSelector selector; // Guarded by queue_mutex
+    size_t queued = 0;     // Tasks in all lanes, guarded by queue_mutex
     std::mutex queue_mutex;
     std::condition_variable condition;
+    std::condition_variable idle;
+    size_t pending = 0; // Enqueued but not yet finished, guarded by queue_mutex
     bool stop = false;
 
 public:
-    ThreadPool(size_t threads) {
+    // pinning != None pins each worker, see topology.h
+    BasicThreadPool(size_t threads, ThreadPinning pinning = ThreadPinning::None,
+                    const LanePolicy& lane_policy = {})
+        : selector(lane_policy) {
+        const std::vector<WorkerPlacement> plan = plan_workers(threads, pinning);
         for (size_t i = 0; i < threads; ++i) {
-            workers.emplace_back([this] {
+            workers.emplace_back([this, pinning, placement = plan[i]] {
+                apply_placement(placement, pinning);
                 while (true) {
-                    std::function<void()> task;
+                    Task task;
                     {
                         std::unique_lock<std::mutex> lock(queue_mutex);
                         condition.wait(lock, [this] { 
-                            return stop || !tasks.empty(); 
+                            return stop || queued > 0; 
+                        });
+                        if (stop && queued == 0) return;
+                        selector.next([&](size_t lane) {
+                            if (lanes[lane].empty()) {
+                                return false;
+                            }
+                            task = std::move(lanes[lane].front());
+                            lanes[lane].pop();
+                            return true;
                         });
-                        if (stop && tasks.empty()) return;
-                        task = std::move(tasks.front());
-                        tasks.pop();
+                        --queued;
                     }
                     task();
+                    {
+                        std::unique_lock<std::mutex> lock(queue_mutex);
+                        if (--pending == 0) {
+                            idle.notify_all();
+                        }
+                    }
                 }
             });
         }
@@ -44,14 +82,27 @@ public:
 
     template<class F>
     void enqueue(F&& f) {
+        enqueue(TaskPriority::Normal, std::forward<F>(f));
+    }
+
+    template<class F>
+    void enqueue(TaskPriority priority, F&& f) {
         {
             std::unique_lock<std::mutex> lock(queue_mutex);
-            tasks.emplace(std::forward<F>(f));
+            lanes[lane_of(priority)].emplace(std::forward<F>(f));
+            ++queued;
+            ++pending;
         }
         condition.notify_one();
     }
 
-    ~ThreadPool() {
+    // Block until every enqueued task has finished
+    void wait_idle() {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        idle.wait(lock, [this] { return pending == 0; });
+    }
+
+    ~BasicThreadPool() {
         {
             std::unique_lock<std::mutex> lock(queue_mutex);
             stop = true;
@@ -63,81 +114,276 @@ public:
     }
 };
 
+// Room for a copied Callback plus a StockPrice
+using ThreadPool = BasicThreadPool<InlineTask<128>>;
+
+// A callback and the pool lane its tasks go to: a risk check subscribes as
+// Critical so a burst of Bulk logging callbacks cannot delay it
+template<typename Event>
+struct Subscription {
+    std::function<void(const Event&)> callback;
+    TaskPriority priority = TaskPriority::Normal;
+};
+
+// Dispatch one event to every subscription, each into its own lane. Small
+// trivially copyable events ride inside each task by value (no allocation);
+// anything else is copied once into a pooled envelope that all subscriber
+// tasks share, instead of once per subscriber.
+template<typename Event, typename Subscriptions>
+void dispatch_to_pool(ThreadPool& pool, const Subscriptions& subscribers, const Event& event) {
+    if constexpr (std::is_trivially_copyable_v<Event> && sizeof(Event) <= 64) {
+        for (const auto& subscriber : subscribers) {
+            pool.enqueue(subscriber.priority, [cb = subscriber.callback, ev = event]() {
+                cb(ev);
+            });
+        }
+    } else {
+        auto envelope = EventEnvelope<Event>::make(event);
+        for (const auto& subscriber : subscribers) {
+            pool.enqueue(subscriber.priority, [cb = subscriber.callback, envelope]() {
+                cb(*envelope);
+            });
+        }
+    }
+}
+
 // Async Event Broker
+// The subscriber list is an RCU snapshot (rcu_snapshot.h, as in example 06):
+// publishers load it without a lock, so they neither serialise on each other
+// nor block subscribe().
 template<typename Event>
 class AsyncEventBroker {
 public:
     using Callback = std::function<void(const Event&)>;
-    
+
 private:
-    std::vector<Callback> subscribers;
+    RcuSnapshot<std::vector<Subscription<Event>>> subscribers;
     ThreadPool& pool;
-    std::mutex mutex;
+    bool verbose;
 
 public:
-    explicit AsyncEventBroker(ThreadPool& thread_pool) : pool(thread_pool) {}
+    explicit AsyncEventBroker(ThreadPool& thread_pool, bool log_publishes = true)
+        : pool(thread_pool), verbose(log_publishes) {}
 
-    void subscribe(Callback callback) {
-        std::lock_guard<std::mutex> lock(mutex);
-        subscribers.push_back(std::move(callback));
+    void subscribe(Callback callback, TaskPriority priority = TaskPriority::Normal) {
+        subscribers.update([&callback, priority](std::vector<Subscription<Event>>& subscriptions) {
+            subscriptions.push_back({callback, priority});
+            return true;
+        });
     }
 
     void publish(const Event& event) {
-        std::lock_guard<std::mutex> lock(mutex);
-        std::cout << "[AsyncBroker] Publishing to " << subscribers.size() 
-                  << " subscribers (parallel)\n";
+        auto snapshot = subscribers.load();
+        if (verbose) {
+            std::stringstream ss;
+            ss << "[AsyncBroker] Publishing to " << snapshot->size()
+               << " subscribers (parallel)\n";
+            std::cout << ss.str() << std::flush;
+        }
         
         // Each subscriber gets processed in parallel
-        for (const auto& subscriber : subscribers) {
-            pool.enqueue([subscriber, event]() {
-                subscriber(event);
-            });
-        }
+        dispatch_to_pool(pool, *snapshot, event);
         // Note: publish() returns immediately, doesn't wait for processing
     }
+
+    // Wait until every dispatched callback has run. The pool may be shared,
+    // so this waits for the whole pool rather than only this broker's tasks.
+    void drain() {
+        pool.wait_idle();
+    }
+};
+
+// Baseline for the contention benchmark: the previous design, which held a
+// mutex around the whole dispatch loop
+template<typename Event>
+class LockedAsyncEventBroker {
+public:
+    using Callback = std::function<void(const Event&)>;
+
+private:
+    std::vector<Subscription<Event>> subscribers;
+    ThreadPool& pool;
+    std::mutex mutex;
+
+public:
+    explicit LockedAsyncEventBroker(ThreadPool& thread_pool) : pool(thread_pool) {}
+
+    void subscribe(Callback callback, TaskPriority priority = TaskPriority::Normal) {
+        std::lock_guard<std::mutex> lock(mutex);
+        subscribers.push_back({std::move(callback), priority});
+    }
+
+    void publish(const Event& event) {
+        std::lock_guard<std::mutex> lock(mutex);
+        dispatch_to_pool(pool, subscribers, event);
+    }
+
+    void drain() {
+        pool.wait_idle();
+    }
 };
 
-// Example event
+// Example event: the symbol is interned, so the event is trivially copyable
+// and the broker can copy it into each task without touching the heap
 struct StockPrice {
-    std::string symbol;
+    SymbolId symbol;
     double price;
     long timestamp;
 };
 
+// Not trivially copyable: published through a shared EventEnvelope
+struct NewsHeadline {
+    SymbolId symbol;
+    std::string headline;
+};
+
 // Subscribers with different processing times
 class RiskEngine {
+private:
+    const SymbolTable& symbols;
+
 public:
+    explicit RiskEngine(const SymbolTable& symbol_table) : symbols(symbol_table) {}
+
     void process(const StockPrice& stock) {
         auto tid = std::this_thread::get_id();
         std::cout << "  [RiskEngine, thread " << tid << "] Analyzing " 
-                  << stock.symbol << " @ $" << stock.price << "\n";
+                  << symbols.name(stock.symbol) << " @ $" << stock.price << "\n";
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
         std::cout << "  [RiskEngine, thread " << tid << "] Analysis complete\n";
     }
 };
 
 class TradingStrategy {
+private:
+    const SymbolTable& symbols;
+
 public:
+    explicit TradingStrategy(const SymbolTable& symbol_table) : symbols(symbol_table) {}
+
     void process(const StockPrice& stock) {
         auto tid = std::this_thread::get_id();
         std::cout << "  [TradingStrategy, thread " << tid << "] Evaluating " 
-                  << stock.symbol << "\n";
+                  << symbols.name(stock.symbol) << "\n";
         std::this_thread::sleep_for(std::chrono::milliseconds(150));
         std::cout << "  [TradingStrategy, thread " << tid << "] Decision made\n";
     }
 };
 
 class DataRecorder {
+private:
+    const SymbolTable& symbols;
+
 public:
+    explicit DataRecorder(const SymbolTable& symbol_table) : symbols(symbol_table) {}
+
     void process(const StockPrice& stock) {
         auto tid = std::this_thread::get_id();
         std::cout << "  [DataRecorder, thread " << tid << "] Recording " 
-                  << stock.symbol << " = $" << stock.price << "\n";
+                  << symbols.name(stock.symbol) << " = $" << stock.price << "\n";
         std::this_thread::sleep_for(std::chrono::milliseconds(50));
     }
 };
 
-int main() {
+// Multi-publisher contention: P threads publish into one broker with four
+// cheap subscribers; reports publishes/s until the pool has drained. The
+// workers are pinned so that runs differ by the broker, not by migrations.
+template<typename Broker, typename... BrokerArgs>
+double publishes_per_sec(size_t publishers, int total_events, BrokerArgs... broker_args) {
+    ThreadPool pool(4, ThreadPinning::Core);
+    Broker broker(pool, broker_args...);
+    ShardedCounter delivered; // A shared atomic here would be the bottleneck being measured
+    for (int i = 0; i < 4; ++i) {
+        broker.subscribe([&delivered](const StockPrice&) {
+            delivered.add();
+        });
+    }
+
+    const int per_publisher = total_events / static_cast<int>(publishers);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < publishers; ++p) {
+        threads.emplace_back([&broker, per_publisher, p] {
+            for (int i = 0; i < per_publisher; ++i) {
+                broker.publish({static_cast<SymbolId>(p), 100.0 + i, i});
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    broker.drain();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (delivered.load() != 4ULL * per_publisher * publishers) {
+        throw std::runtime_error("contention benchmark lost deliveries");
+    }
+    return per_publisher * publishers / elapsed.count();
+}
+
+int run_contention_benchmark() {
+    std::cout << "=== Multi-publisher contention: RCU snapshot vs mutex ===\n"
+              << "(" << Topology::get().describe() << ", pool workers pinned per core)\n";
+    const int total_events = 40000;
+    for (size_t publishers : {1, 2, 4, 8}) {
+        double rcu = publishes_per_sec<AsyncEventBroker<StockPrice>>(publishers, total_events, false);
+        double locked = publishes_per_sec<LockedAsyncEventBroker<StockPrice>>(publishers, total_events);
+        std::stringstream ss;
+        ss << "  " << publishers << " publishers: RCU " << static_cast<long>(rcu)
+           << " publishes/s, mutex " << static_cast<long>(locked) << " publishes/s\n";
+        std::cout << ss.str() << std::flush;
+    }
+    return 0;
+}
+
+// --bench-json: producers publish workload.ops events of event_bytes to
+// `subscribers` callbacks of task_ns work each, dispatched to a pool of
+// workload.consumers workers; latency is publish -> callback start
+template<template<typename> class Broker, typename... BrokerArgs>
+void measure_broker(BenchReport& report, const char* variant, BrokerArgs... broker_args) {
+    const Workload& load = report.workload();
+    with_event_size(load.event_bytes, [&](auto bytes) {
+        using Event = BenchPayload<decltype(bytes)::value>;
+        report.measure("AsyncEventBroker", variant, [&](TrialTimer& timer, LatencyRecorder& latency) {
+            ThreadPool pool(load.consumers);
+            Broker<Event> broker(pool, broker_args...);
+            for (size_t s = 0; s < load.subscribers; ++s) {
+                broker.subscribe([&latency, work = load.task_ns](const Event& event) {
+                    latency.record(latency_now() - event.sent_ns);
+                    busy_work(work);
+                });
+            }
+            timer.start();
+            std::vector<std::thread> producers;
+            for (size_t p = 0; p < load.producers; ++p) {
+                producers.emplace_back([&, p] {
+                    Event event{};
+                    for (uint64_t i = share_of(load.ops, load.producers, p); i > 0; --i) {
+                        event.sent_ns = latency_now();
+                        broker.publish(event);
+                    }
+                });
+            }
+            for (auto& producer : producers) {
+                producer.join();
+            }
+            broker.drain();
+            timer.stop();
+        });
+    });
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        return run_contention_benchmark();
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-json") {
+        return run_bench_json(argc, argv, 2, "05_pubsub_async_threadpool", [](BenchReport& report) {
+            measure_broker<AsyncEventBroker>(report, "RCU snapshot", false);
+            measure_broker<LockedAsyncEventBroker>(report, "mutex");
+        });
+    }
+
     std::cout << "=== Async Publisher/Subscriber with Thread Pool ===\n\n";
 
     // Create thread pool
@@ -147,32 +393,54 @@ int main() {
     // Create async event broker
     AsyncEventBroker<StockPrice> broker(pool);
 
+    // Symbols are interned once; events carry the id
+    SymbolTable symbols;
+    const SymbolId aapl = symbols.intern("AAPL");
+    const SymbolId googl = symbols.intern("GOOGL");
+    const SymbolId msft = symbols.intern("MSFT");
+
     // Create and register subscribers
-    RiskEngine risk;
-    TradingStrategy strategy;
-    DataRecorder recorder;
+    RiskEngine risk(symbols);
+    TradingStrategy strategy(symbols);
+    DataRecorder recorder(symbols);
 
-    broker.subscribe([&risk](const StockPrice& s) { risk.process(s); });
+    // The risk check never waits behind recording work in the pool
+    broker.subscribe([&risk](const StockPrice& s) { risk.process(s); }, TaskPriority::Critical);
     broker.subscribe([&strategy](const StockPrice& s) { strategy.process(s); });
-    broker.subscribe([&recorder](const StockPrice& s) { recorder.process(s); });
+    broker.subscribe([&recorder](const StockPrice& s) { recorder.process(s); }, TaskPriority::Bulk);
 
     std::cout << "Subscribers registered\n\n";
 
     // Publish events
     std::cout << "--- Publishing AAPL ---\n";
-    broker.publish({"AAPL", 175.50, 1234567890});
+    broker.publish({aapl, 175.50, 1234567890});
     
     std::cout << "\n--- Publishing GOOGL ---\n";
-    broker.publish({"GOOGL", 140.25, 1234567891});
+    broker.publish({googl, 140.25, 1234567891});
 
     std::cout << "\n--- Publishing MSFT ---\n";
-    broker.publish({"MSFT", 380.00, 1234567892});
+    broker.publish({msft, 380.00, 1234567892});
 
     std::cout << "\n[Main] All events published (non-blocking)\n";
     std::cout << "[Main] Waiting for processing to complete...\n\n";
 
     // Wait for all processing to complete
-    std::this_thread::sleep_for(std::chrono::seconds(2));
+    broker.drain();
+
+    // A headline owns a string, so the broker shares one pooled copy of it
+    // between all subscriber tasks instead of copying it per subscriber
+    std::cout << "\n--- Publishing a news headline (shared envelope) ---\n";
+    AsyncEventBroker<NewsHeadline> news(pool);
+    for (const char* desk : {"Equities", "Options", "Compliance"}) {
+        news.subscribe([desk, &symbols](const NewsHeadline& item) {
+            std::stringstream ss;
+            ss << "  [" << desk << " desk] " << symbols.name(item.symbol)
+               << ": " << item.headline << "\n";
+            std::cout << ss.str() << std::flush;
+        });
+    }
+    news.publish({aapl, "Apple announces quarterly results after the close, guidance above consensus"});
+    news.drain();
 
     std::cout << "\n[Main] Exiting (pool will cleanup)\n";
 
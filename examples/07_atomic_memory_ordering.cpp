@@ -9,6 +9,16 @@
 #include <vector>
 #include <cassert>
 #include <mutex>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "sharded_counter.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
 
 // Example 1: Sequentially Consistent (default)
 class SequentiallyConsistent {
@@ -96,6 +106,156 @@ public:
     }
 };
 
+// Spin-wait hint: lets the sibling hyperthread run and saves power
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// Exponential backoff for spin loops: 1, 2, 4, ... pauses between polls,
+// then yield() once the wait is long, so spinners on an oversubscribed
+// machine don't burn the time slice the lock holder needs
+class Backoff {
+private:
+    static constexpr uint32_t kMaxPauses = 1024;
+    uint32_t pauses = 1;
+
+public:
+    void pause() {
+        if (pauses > kMaxPauses) {
+            std::this_thread::yield();
+            return;
+        }
+        for (uint32_t i = 0; i < pauses; ++i) {
+            cpu_relax();
+        }
+        pauses *= 2;
+    }
+};
+
+// Example 4b: Test-and-test-and-set with backoff
+// Waiters spin on a plain load, which hits their own cached copy of the
+// line; only when the lock looks free do they try the RMW exchange
+class TTASSpinlock {
+private:
+    std::atomic<bool> locked{false};
+
+public:
+    void lock() {
+        while (locked.exchange(true, std::memory_order_acquire)) {
+            Backoff backoff;
+            while (locked.load(std::memory_order_relaxed)) {
+                backoff.pause();
+            }
+        }
+    }
+
+    void unlock() {
+        locked.store(false, std::memory_order_release);
+    }
+};
+
+// Example 4c: Ticket lock
+// One fetch_add per acquisition, then FIFO: the lock is handed over in
+// ticket order, so no waiter can starve
+class TicketLock {
+private:
+    alignas(64) std::atomic<uint32_t> next_ticket{0};
+    alignas(64) std::atomic<uint32_t> now_serving{0};
+
+public:
+    void lock() {
+        const uint32_t ticket = next_ticket.fetch_add(1, std::memory_order_relaxed);
+        Backoff backoff;
+        while (now_serving.load(std::memory_order_acquire) != ticket) {
+            backoff.pause();
+        }
+    }
+
+    void unlock() {
+        // Only the holder writes now_serving
+        now_serving.store(now_serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+};
+
+// Example 4d: MCS queue lock
+// Waiters form a linked queue and each spins on a flag in its own node, so
+// a hand-over touches one waiter's cache line instead of all of them.
+// Nodes come from a per-thread cache, keeping the plain lock()/unlock()
+// interface (and allowing a thread to hold several MCS locks at once).
+class MCSLock {
+private:
+    struct alignas(64) Node {
+        std::atomic<Node*> next{nullptr};
+        std::atomic<bool> locked{false};
+    };
+
+    struct NodeCache {
+        std::vector<Node*> nodes;
+
+        ~NodeCache() {
+            for (Node* node : nodes) {
+                delete node;
+            }
+        }
+    };
+
+    static NodeCache& node_cache() {
+        thread_local NodeCache cache;
+        return cache;
+    }
+
+    alignas(64) std::atomic<Node*> tail{nullptr};
+    Node* owner = nullptr; // The holder's node, only touched by the holder
+
+public:
+    void lock() {
+        auto& cache = node_cache().nodes;
+        Node* node = cache.empty() ? new Node : cache.back();
+        if (!cache.empty()) {
+            cache.pop_back();
+        }
+        node->next.store(nullptr, std::memory_order_relaxed);
+        node->locked.store(true, std::memory_order_relaxed);
+
+        Node* prev = tail.exchange(node, std::memory_order_acq_rel);
+        if (prev) {
+            prev->next.store(node, std::memory_order_release);
+            Backoff backoff;
+            while (node->locked.load(std::memory_order_acquire)) {
+                backoff.pause();
+            }
+        }
+        owner = node;
+    }
+
+    void unlock() {
+        Node* node = owner;
+        Node* next = node->next.load(std::memory_order_acquire);
+        if (!next) {
+            Node* expected = node;
+            if (tail.compare_exchange_strong(expected, nullptr,
+                                             std::memory_order_acq_rel,
+                                             std::memory_order_relaxed)) {
+                node_cache().nodes.push_back(node);
+                return;
+            }
+            // A waiter swapped itself in but hasn't linked to us yet
+            Backoff backoff;
+            while (!(next = node->next.load(std::memory_order_acquire))) {
+                backoff.pause();
+            }
+        }
+        next->locked.store(false, std::memory_order_release);
+        node_cache().nodes.push_back(node);
+    }
+};
+
 // Example 5: Double-Checked Locking (lazy initialization)
 class Singleton {
 private:
@@ -165,6 +325,89 @@ void test_lock_free_counter() {
 
     std::cout << "Expected: " << (num_threads * increments_per_thread) << "\n";
     std::cout << "Actual: " << counter.get() << "\n";
+
+    // Same count without a shared cache line: each thread bumps its own
+    // padded slot and load() sums them
+    ShardedCounter sharded;
+    threads.clear();
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back([&sharded, increments_per_thread]() {
+            for (int j = 0; j < increments_per_thread; ++j) {
+                sharded.add();
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    std::cout << "Sharded: " << sharded.load() << "\n";
+}
+
+// Benchmark: one shared counter vs per-thread slots, 1-64 threads
+// Run with: 07_atomic_memory_ordering --bench (or the bench_counters target)
+template<typename Increment>
+double increments_per_sec(int num_threads, int increments_per_thread, Increment increment) {
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back([&go, &increment, increments_per_thread]() {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (int j = 0; j < increments_per_thread; ++j) {
+                increment();
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads) {
+        t.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return num_threads * static_cast<double>(increments_per_thread) / elapsed.count();
+}
+
+int run_counter_benchmark() {
+    const int increments_per_thread = 200000;
+    std::cout << "=== Counter scaling: shared atomic vs CAS vs ShardedCounter ===\n";
+    std::cout << "(hardware threads: " << std::thread::hardware_concurrency() << ")\n";
+    std::cout << "threads   fetch_add Mops/s   CAS loop Mops/s   sharded Mops/s\n";
+
+    bool correct = true;
+    for (int num_threads : {1, 2, 4, 8, 16, 32, 64}) {
+        const uint64_t expected = static_cast<uint64_t>(num_threads) * increments_per_thread;
+
+        std::atomic<uint64_t> shared{0};
+        double atomic_rate = increments_per_sec(num_threads, increments_per_thread, [&shared] {
+            shared.fetch_add(1, std::memory_order_relaxed);
+        });
+
+        LockFreeCounter cas;
+        double cas_rate = increments_per_sec(num_threads, increments_per_thread, [&cas] {
+            cas.increment();
+        });
+
+        ShardedCounter sharded;
+        double sharded_rate = increments_per_sec(num_threads, increments_per_thread, [&sharded] {
+            sharded.add();
+        });
+
+        correct = correct && shared.load() == expected &&
+                  static_cast<uint64_t>(cas.get()) == expected && sharded.load() == expected;
+
+        std::stringstream ss;
+        ss.setf(std::ios::fixed);
+        ss.precision(1);
+        ss << "  " << num_threads << (num_threads < 10 ? "          " : "         ")
+           << atomic_rate / 1e6 << "             " << cas_rate / 1e6
+           << "             " << sharded_rate / 1e6 << "\n";
+        std::cout << ss.str() << std::flush;
+    }
+
+    std::cout << (correct ? "All counts correct\n" : "COUNT MISMATCH\n");
+    return correct ? 0 : 1;
 }
 
 void test_spinlock() {
@@ -190,8 +433,137 @@ void test_spinlock() {
     std::cout << "Shared data: " << shared_data << "\n";
 }
 
+template<typename Lock>
+void check_lock(const char* name) {
+    Lock lock;
+    long shared_data = 0;
+    const int num_threads = 4;
+    const int increments_per_thread = 20000;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back([&lock, &shared_data, increments_per_thread]() {
+            for (int j = 0; j < increments_per_thread; ++j) {
+                lock.lock();
+                shared_data++;
+                lock.unlock();
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    std::cout << "  " << name << shared_data << " (expected "
+              << num_threads * increments_per_thread << ")\n";
+}
+
+void test_scalable_locks() {
+    std::cout << "\n=== Test 5: Scalable Spinlocks ===\n";
+    check_lock<TTASSpinlock>("TTAS + backoff: ");
+    check_lock<TicketLock>("Ticket lock:    ");
+    check_lock<MCSLock>("MCS lock:       ");
+}
+
+// Benchmark: lock throughput and fairness under contention
+// Run with: 07_atomic_memory_ordering --bench-locks (or the bench_locks target)
+struct LockResult {
+    double mops_per_sec;
+    double fairness; // Fewest / most acquisitions by one thread (1.0 = perfectly fair)
+    bool correct;
+};
+
+template<typename Lock>
+LockResult measure_lock(int num_threads, std::chrono::milliseconds duration) {
+    struct alignas(64) PerThread {
+        uint64_t acquisitions = 0;
+    };
+
+    Lock lock;
+    uint64_t protected_data[4] = {}; // A short critical section: a few writes to one line
+    std::vector<PerThread> per_thread(num_threads);
+    std::atomic<bool> go{false};
+    std::atomic<bool> stop{false};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back([&, i]() {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            uint64_t mine = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                lock.lock();
+                for (uint64_t& word : protected_data) {
+                    ++word;
+                }
+                lock.unlock();
+                ++mine;
+            }
+            per_thread[i].acquisitions = mine;
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(duration);
+    stop.store(true, std::memory_order_relaxed);
+    for (auto& t : threads) {
+        t.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    uint64_t total = 0;
+    uint64_t fewest = UINT64_MAX;
+    uint64_t most = 0;
+    for (const auto& counts : per_thread) {
+        total += counts.acquisitions;
+        fewest = std::min(fewest, counts.acquisitions);
+        most = std::max(most, counts.acquisitions);
+    }
+
+    LockResult result;
+    result.mops_per_sec = static_cast<double>(total) / elapsed.count() / 1e6;
+    result.fairness = most == 0 ? 0.0 : static_cast<double>(fewest) / static_cast<double>(most);
+    result.correct = protected_data[0] == total && protected_data[3] == total;
+    return result;
+}
+
+int run_lock_benchmark() {
+    const auto duration = std::chrono::milliseconds(50);
+    std::cout << "=== Lock contention: throughput (Mops/s) and fairness (min/max per thread) ===\n";
+    std::cout << "(hardware threads: " << std::thread::hardware_concurrency() << ")\n";
+
+    bool correct = true;
+    for (int num_threads : {1, 2, 4, 8, 16}) {
+        const LockResult results[] = {
+            measure_lock<Spinlock>(num_threads, duration),
+            measure_lock<TTASSpinlock>(num_threads, duration),
+            measure_lock<TicketLock>(num_threads, duration),
+            measure_lock<MCSLock>(num_threads, duration),
+            measure_lock<std::mutex>(num_threads, duration),
+        };
+        const char* names[] = {"TAS + yield", "TTAS + backoff", "Ticket", "MCS", "std::mutex"};
+
+        std::stringstream ss;
+        ss.setf(std::ios::fixed);
+        ss << num_threads << " threads:\n";
+        for (size_t i = 0; i < 5; ++i) {
+            ss.precision(1);
+            ss << "  " << names[i] << std::string(16 - std::string(names[i]).size(), ' ')
+               << results[i].mops_per_sec << " Mops/s, fairness ";
+            ss.precision(2);
+            ss << results[i].fairness << "\n";
+            correct = correct && results[i].correct;
+        }
+        std::cout << ss.str() << std::flush;
+    }
+
+    std::cout << (correct ? "All critical sections consistent\n" : "LOCK VIOLATION\n");
+    return correct ? 0 : 1;
+}
+
 void test_singleton() {
-    std::cout << "\n=== Test 5: Double-Checked Locking Singleton ===\n";
+    std::cout << "\n=== Test 6: Double-Checked Locking Singleton ===\n";
     
     std::vector<std::thread> threads;
     for (int i = 0; i < 10; ++i) {
@@ -206,22 +578,31 @@ void test_singleton() {
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::strcmp(argv[1], "--bench") == 0) {
+        return run_counter_benchmark();
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--bench-locks") == 0) {
+        return run_lock_benchmark();
+    }
+
     std::cout << "=== Atomic Operations and Memory Ordering Examples ===\n";
 
     test_sequential_consistency();
     test_acquire_release();
     test_lock_free_counter();
     test_spinlock();
+    test_scalable_locks();
     test_singleton();
 
     std::cout << "\n=== All tests completed ===\n";
     std::cout << "\nKey concepts demonstrated:\n";
     std::cout << "  1. Sequential consistency (strongest, slowest)\n";
     std::cout << "  2. Acquire-Release (synchronization without seq_cst overhead)\n";
-    std::cout << "  3. Compare-and-swap (lock-free algorithms)\n";
+    std::cout << "  3. Compare-and-swap (lock-free algorithms), sharded counters\n";
     std::cout << "  4. Spinlock (busy-waiting synchronization)\n";
-    std::cout << "  5. Double-checked locking (lazy initialization)\n";
+    std::cout << "  5. TTAS, ticket and MCS locks (less coherence traffic, fairness)\n";
+    std::cout << "  6. Double-checked locking (lazy initialization)\n";
 
     return 0;
 }
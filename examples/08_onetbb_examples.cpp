@@ -1,6 +1,7 @@
 // Example 8: OneTBB Thread Pool and Parallel Algorithms
 // Demonstrates Intel Threading Building Blocks (oneTBB)
-// Topics: tbb::parallel_for, tbb::parallel_for_each, tbb::task_group
+// Topics: tbb::parallel_for, tbb::parallel_for_each, tbb::task_group,
+//         tbb::parallel_reduce, partitioners, SIMD kernels
 // 
 // To compile: g++ -std=c++17 08_onetbb_examples.cpp -ltbb -o tbb_example
 // Note: Requires oneTBB library installed
@@ -10,6 +11,19 @@
 #include <string>
 #include <chrono>
 #include <cmath>
+#include <cctype>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <sstream>
+#include <iomanip>
+#include <memory>
+#include <cstdlib>
+
+#include "bench_harness.h"
+#include "rcu_snapshot.h"
+#include "sharded_counter.h"
 
 // OneTBB headers
 #ifdef __has_include
@@ -19,6 +33,9 @@
 #    include <tbb/task_group.h>
 #    include <tbb/blocked_range.h>
 #    include <tbb/global_control.h>
+#    include <tbb/parallel_reduce.h>
+#    include <tbb/partitioner.h>
+#    include <tbb/task_arena.h>
 #    define HAS_TBB 1
 #  else
 #    define HAS_TBB 0
@@ -27,6 +44,25 @@
 #  define HAS_TBB 0
 #endif
 
+// Parallel STL reductions (libstdc++ runs them on TBB)
+#if HAS_TBB && __has_include(<execution>)
+#  include <execution>
+#  include <numeric>
+#endif
+#if HAS_TBB && defined(__cpp_lib_parallel_algorithm)
+#  define HAS_PARALLEL_STL 1
+#else
+#  define HAS_PARALLEL_STL 0
+#endif
+
+// Hand-vectorised kernels, dispatched at run time (GCC / Clang on x86)
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#  include <immintrin.h>
+#  define HAS_X86_KERNELS 1
+#else
+#  define HAS_X86_KERNELS 0
+#endif
+
 #if HAS_TBB
 
 // Example 1: parallel_for - Simple range iteration
@@ -72,11 +108,46 @@ void example_parallel_for_each() {
 }
 
 // Example 3: Publisher/Subscriber with TBB
+// Callbacks live in an RCU snapshot (rcu_snapshot.h, as in example 06):
+// publish loads it without a lock and iterates it in place, no per-publish copy
 template<typename Event>
 class TBBEventBroker {
 public:
     using Callback = std::function<void(const Event&)>;
 
+private:
+    RcuSnapshot<std::vector<Callback>> callbacks;
+
+public:
+    void subscribe(Callback cb) {
+        callbacks.update([&cb](std::vector<Callback>& list) {
+            list.push_back(cb);
+            return true;
+        });
+    }
+
+    void publish_parallel(const Event& event) {
+        auto snapshot = callbacks.load(); // Stays alive until dispatch finishes
+        
+        // Parallel dispatch using TBB
+        tbb::parallel_for_each(snapshot->begin(), snapshot->end(),
+            [&event](const Callback& cb) {
+                cb(event);
+            });
+    }
+
+    size_t subscriber_count() const {
+        return callbacks.load()->size();
+    }
+};
+
+// Baseline for the contention benchmark: the previous design, which copied
+// the whole callback vector under a mutex on every publish
+template<typename Event>
+class LockedTBBEventBroker {
+public:
+    using Callback = std::function<void(const Event&)>;
+
 private:
     std::vector<Callback> callbacks;
     std::mutex mutex;
@@ -93,18 +164,11 @@ public:
             std::lock_guard<std::mutex> lock(mutex);
             local_callbacks = callbacks;
         }
-        
-        // Parallel dispatch using TBB
         tbb::parallel_for_each(local_callbacks.begin(), local_callbacks.end(),
             [&event](const Callback& cb) {
                 cb(event);
             });
     }
-
-    size_t subscriber_count() {
-        std::lock_guard<std::mutex> lock(mutex);
-        return callbacks.size();
-    }
 };
 
 struct MarketData {
@@ -170,39 +234,583 @@ void example_task_group() {
     std::cout << "All tasks completed\n";
 }
 
-// Example 5: Benchmark - Sequential vs Parallel
+// Example 5: kernel suite -- where is the loop compute-bound, where
+// bandwidth-bound? Three kernels, each in a scalar, compiler-vectorised and
+// hand-vectorised (AVX2 / AVX-512, picked at run time) variant:
+//   poly  - Horner polynomial per element: lots of FLOPs per byte
+//   triad - STREAM a = b + s * c: 2 FLOPs per 24 bytes
+//   dot   - sum of b * c as a reduction (parallel_reduce, std::transform_reduce)
+// Rates are the mean of repeated trials, with the coefficient of variation.
+constexpr int kPolyDegree = 32;
+constexpr double kPolyCoefficients[kPolyDegree + 1] = {
+    1.0,  -0.5,  0.33, -0.25, 0.2,  -0.16, 0.14, -0.12, 0.11, -0.1, 0.09,
+    -0.083, 0.077, -0.071, 0.066, -0.062, 0.058, -0.055, 0.052, -0.05, 0.047, -0.045,
+    0.043, -0.041, 0.04, -0.038, 0.037, -0.035, 0.034, -0.033, 0.032, -0.031, 0.03};
+
+struct KernelCost {
+    double flops_per_element;
+    double bytes_per_element; // Compulsory traffic, STREAM convention (no write-allocate)
+};
+
+constexpr KernelCost kPolyCost{2.0 * kPolyDegree, 16.0};
+constexpr KernelCost kTriadCost{2.0, 24.0};
+constexpr KernelCost kDotCost{2.0, 16.0};
+
+// The baseline must stay scalar even at -O3
+#if defined(__clang__)
+#  define SCALAR_KERNEL
+#  define SCALAR_LOOP _Pragma("clang loop vectorize(disable) interleave(disable)")
+#elif defined(__GNUC__)
+#  define SCALAR_KERNEL __attribute__((optimize("no-tree-vectorize")))
+#  define SCALAR_LOOP
+#else
+#  define SCALAR_KERNEL
+#  define SCALAR_LOOP
+#endif
+
+SCALAR_KERNEL void poly_scalar(const double* x, double* y, size_t n) {
+    SCALAR_LOOP
+    for (size_t i = 0; i < n; ++i) {
+        double acc = kPolyCoefficients[0];
+        for (int k = 1; k <= kPolyDegree; ++k) {
+            acc = acc * x[i] + kPolyCoefficients[k];
+        }
+        y[i] = acc;
+    }
+}
+
+SCALAR_KERNEL void triad_scalar(double* a, const double* b, const double* c, double s, size_t n) {
+    SCALAR_LOOP
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = b[i] + s * c[i];
+    }
+}
+
+SCALAR_KERNEL double dot_scalar(const double* b, const double* c, size_t n) {
+    double sum = 0.0;
+    SCALAR_LOOP
+    for (size_t i = 0; i < n; ++i) {
+        sum += b[i] * c[i];
+    }
+    return sum;
+}
+
+// Same loops, left to the compiler's vectoriser at the build's -march
+void poly_auto(const double* x, double* y, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        double acc = kPolyCoefficients[0];
+        for (int k = 1; k <= kPolyDegree; ++k) {
+            acc = acc * x[i] + kPolyCoefficients[k];
+        }
+        y[i] = acc;
+    }
+}
+
+void triad_auto(double* a, const double* b, const double* c, double s, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = b[i] + s * c[i];
+    }
+}
+
+double dot_auto(const double* b, const double* c, size_t n) {
+    // Four partial sums: without -ffast-math the compiler may not reassociate
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += b[i] * c[i];
+        s1 += b[i + 1] * c[i + 1];
+        s2 += b[i + 2] * c[i + 2];
+        s3 += b[i + 3] * c[i + 3];
+    }
+    for (; i < n; ++i) {
+        s0 += b[i] * c[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+#if HAS_X86_KERNELS
+// Hand-vectorised variants, compiled for their ISA with target attributes
+// so the rest of the file keeps the baseline flags; only called after
+// __builtin_cpu_supports() said yes. Four independent accumulators per
+// iteration hide the FMA latency.
+__attribute__((target("avx2,fma"))) void poly_avx2(const double* x, double* y, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256d v[4], acc[4];
+        for (int j = 0; j < 4; ++j) {
+            v[j] = _mm256_loadu_pd(x + i + 4 * j);
+            acc[j] = _mm256_set1_pd(kPolyCoefficients[0]);
+        }
+        for (int k = 1; k <= kPolyDegree; ++k) {
+            const __m256d coefficient = _mm256_set1_pd(kPolyCoefficients[k]);
+            for (int j = 0; j < 4; ++j) {
+                acc[j] = _mm256_fmadd_pd(acc[j], v[j], coefficient);
+            }
+        }
+        for (int j = 0; j < 4; ++j) {
+            _mm256_storeu_pd(y + i + 4 * j, acc[j]);
+        }
+    }
+    poly_scalar(x + i, y + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) void triad_avx2(double* a, const double* b, const double* c, double s,
+                                                    size_t n) {
+    const __m256d scale = _mm256_set1_pd(s);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(a + i, _mm256_fmadd_pd(scale, _mm256_loadu_pd(c + i), _mm256_loadu_pd(b + i)));
+    }
+    triad_scalar(a + i, b + i, c + i, s, n - i);
+}
+
+__attribute__((target("avx2,fma"))) double dot_avx2(const double* b, const double* c, size_t n) {
+    __m256d acc[4] = {_mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd()};
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        for (int j = 0; j < 4; ++j) {
+            acc[j] = _mm256_fmadd_pd(_mm256_loadu_pd(b + i + 4 * j), _mm256_loadu_pd(c + i + 4 * j), acc[j]);
+        }
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, _mm256_add_pd(_mm256_add_pd(acc[0], acc[1]), _mm256_add_pd(acc[2], acc[3])));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + dot_scalar(b + i, c + i, n - i);
+}
+
+__attribute__((target("avx512f"))) void poly_avx512(const double* x, double* y, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512d v[4], acc[4];
+        for (int j = 0; j < 4; ++j) {
+            v[j] = _mm512_loadu_pd(x + i + 8 * j);
+            acc[j] = _mm512_set1_pd(kPolyCoefficients[0]);
+        }
+        for (int k = 1; k <= kPolyDegree; ++k) {
+            const __m512d coefficient = _mm512_set1_pd(kPolyCoefficients[k]);
+            for (int j = 0; j < 4; ++j) {
+                acc[j] = _mm512_fmadd_pd(acc[j], v[j], coefficient);
+            }
+        }
+        for (int j = 0; j < 4; ++j) {
+            _mm512_storeu_pd(y + i + 8 * j, acc[j]);
+        }
+    }
+    poly_scalar(x + i, y + i, n - i);
+}
+
+__attribute__((target("avx512f"))) void triad_avx512(double* a, const double* b, const double* c, double s,
+                                                     size_t n) {
+    const __m512d scale = _mm512_set1_pd(s);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(a + i, _mm512_fmadd_pd(scale, _mm512_loadu_pd(c + i), _mm512_loadu_pd(b + i)));
+    }
+    triad_scalar(a + i, b + i, c + i, s, n - i);
+}
+
+__attribute__((target("avx512f"))) double dot_avx512(const double* b, const double* c, size_t n) {
+    __m512d acc[4] = {_mm512_setzero_pd(), _mm512_setzero_pd(), _mm512_setzero_pd(), _mm512_setzero_pd()};
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        for (int j = 0; j < 4; ++j) {
+            acc[j] = _mm512_fmadd_pd(_mm512_loadu_pd(b + i + 8 * j), _mm512_loadu_pd(c + i + 8 * j), acc[j]);
+        }
+    }
+    alignas(64) double lanes[8];
+    _mm512_store_pd(lanes, _mm512_add_pd(_mm512_add_pd(acc[0], acc[1]), _mm512_add_pd(acc[2], acc[3])));
+    double sum = 0.0;
+    for (double lane : lanes) {
+        sum += lane;
+    }
+    return sum + dot_scalar(b + i, c + i, n - i);
+}
+#endif
+
+enum class Isa { Scalar, Auto, Avx2, Avx512 };
+
+struct KernelSet {
+    Isa isa;
+    const char* name;
+    void (*poly)(const double*, double*, size_t);
+    void (*triad)(double*, const double*, const double*, double, size_t);
+    double (*dot)(const double*, const double*, size_t);
+};
+
+// Variants this CPU can run, widest last
+std::vector<KernelSet> available_kernel_sets() {
+    std::vector<KernelSet> sets = {
+        {Isa::Scalar, "scalar", poly_scalar, triad_scalar, dot_scalar},
+        {Isa::Auto, "auto-vec", poly_auto, triad_auto, dot_auto},
+    };
+#if HAS_X86_KERNELS
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        sets.push_back({Isa::Avx2, "avx2+fma", poly_avx2, triad_avx2, dot_avx2});
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        sets.push_back({Isa::Avx512, "avx-512", poly_avx512, triad_avx512, dot_avx512});
+    }
+#endif
+    return sets;
+}
+
+// How parallel_for / parallel_reduce split the range
+struct Schedule {
+    enum class Partitioner { Auto, Simple, Static } partitioner;
+    size_t grain;
+    const char* name;
+};
+
+const Schedule kAutoSchedule{Schedule::Partitioner::Auto, 1, "auto"};
+
+template<typename Body>
+void parallel_range(size_t n, const Schedule& schedule, const Body& body) {
+    const tbb::blocked_range<size_t> range(0, n, schedule.grain);
+    auto run = [&body](const tbb::blocked_range<size_t>& r) { body(r.begin(), r.end()); };
+    switch (schedule.partitioner) {
+    case Schedule::Partitioner::Auto:
+        tbb::parallel_for(range, run, tbb::auto_partitioner());
+        break;
+    case Schedule::Partitioner::Simple:
+        tbb::parallel_for(range, run, tbb::simple_partitioner());
+        break;
+    case Schedule::Partitioner::Static:
+        tbb::parallel_for(range, run, tbb::static_partitioner());
+        break;
+    }
+}
+
+template<typename Body>
+double parallel_sum(size_t n, const Schedule& schedule, const Body& body) {
+    const tbb::blocked_range<size_t> range(0, n, schedule.grain);
+    auto run = [&body](const tbb::blocked_range<size_t>& r, double partial) {
+        return partial + body(r.begin(), r.end());
+    };
+    switch (schedule.partitioner) {
+    case Schedule::Partitioner::Simple:
+        return tbb::parallel_reduce(range, 0.0, run, std::plus<double>(), tbb::simple_partitioner());
+    case Schedule::Partitioner::Static:
+        return tbb::parallel_reduce(range, 0.0, run, std::plus<double>(), tbb::static_partitioner());
+    case Schedule::Partitioner::Auto:
+        break;
+    }
+    return tbb::parallel_reduce(range, 0.0, run, std::plus<double>(), tbb::auto_partitioner());
+}
+
+struct KernelData {
+    size_t n;
+    std::unique_ptr<double[]> x, y, a, b, c;
+
+    // Left uninitialised by new[] and first written in parallel with a
+    // static partition, so on a NUMA machine each page lives near the
+    // thread that streams it
+    explicit KernelData(size_t elements)
+        : n(elements), x(new double[n]), y(new double[n]), a(new double[n]), b(new double[n]), c(new double[n]) {
+        parallel_range(n, Schedule{Schedule::Partitioner::Static, 1, "static"}, [this](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                x[i] = static_cast<double>(i % 1000) / 1000.0;
+                y[i] = 0.0;
+                a[i] = 0.0;
+                b[i] = 1.0 + static_cast<double>(i % 7);
+                c[i] = 0.5 - static_cast<double>(i % 3) * 0.25;
+            }
+        });
+    }
+};
+
+struct Rate {
+    double gflops;
+    double gbps;
+    double cv_percent; // Trial-to-trial coefficient of variation
+};
+
+// One warm-up run, then `trials` timed ones
+template<typename Run>
+Rate measure_rate(const KernelCost& cost, size_t n, int trials, const Run& run) {
+    run();
+    std::vector<double> seconds;
+    for (int t = 0; t < trials; ++t) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    double mean = 0.0;
+    for (double s : seconds) {
+        mean += s / trials;
+    }
+    double variance = 0.0;
+    for (double s : seconds) {
+        variance += (s - mean) * (s - mean) / trials;
+    }
+    return Rate{cost.flops_per_element * n / mean / 1e9, cost.bytes_per_element * n / mean / 1e9,
+                100.0 * std::sqrt(variance) / mean};
+}
+
+enum class Kernel { Poly, Triad, Dot };
+
+// A reduction's result is checked against the sequential sum: summation
+// order differs, so only to a relative tolerance
+template<typename Check>
+Rate run_kernel(Kernel kernel, const KernelSet& set, const Schedule& schedule, KernelData& data, int trials,
+                const Check& check_dot) {
+    const size_t n = data.n;
+    switch (kernel) {
+    case Kernel::Poly:
+        return measure_rate(kPolyCost, n, trials, [&] {
+            parallel_range(n, schedule, [&](size_t begin, size_t end) {
+                set.poly(data.x.get() + begin, data.y.get() + begin, end - begin);
+            });
+        });
+    case Kernel::Triad:
+        return measure_rate(kTriadCost, n, trials, [&] {
+            parallel_range(n, schedule, [&](size_t begin, size_t end) {
+                set.triad(data.a.get() + begin, data.b.get() + begin, data.c.get() + begin, 3.0, end - begin);
+            });
+        });
+    case Kernel::Dot:
+        break;
+    }
+    return measure_rate(kDotCost, n, trials, [&] {
+        check_dot(parallel_sum(n, schedule, [&](size_t begin, size_t end) {
+            return set.dot(data.b.get() + begin, data.c.get() + begin, end - begin);
+        }));
+    });
+}
+
+const char* kernel_name(Kernel kernel) {
+    switch (kernel) {
+    case Kernel::Poly: return "poly ";
+    case Kernel::Triad: return "triad";
+    case Kernel::Dot: return "dot  ";
+    }
+    return "?";
+}
+
+std::string format_rate(const Rate& rate) {
+    std::stringstream ss;
+    ss.setf(std::ios::fixed);
+    ss.precision(2);
+    ss << rate.gflops << " GFLOP/s  " << rate.gbps << " GB/s  +-";
+    ss.precision(1);
+    ss << rate.cv_percent << "%";
+    return ss.str();
+}
+
+// quick: one pass at full width (Example 5); otherwise also the
+// partitioner / grain sweep and a thread-count sweep through global_control
+int run_kernel_suite(bool quick) {
+    const size_t n = size_t{1} << 22; // 32MB per array: well past the last-level cache of most CPUs
+    const int trials = quick ? 3 : 7;
+    const int max_threads = tbb::this_task_arena::max_concurrency();
+    KernelData data(n);
+    const std::vector<KernelSet> sets = available_kernel_sets();
+    const KernelSet& widest = sets.back();
+
+    const double expected_dot = dot_scalar(data.b.get(), data.c.get(), n);
+    bool correct = true;
+    auto check_dot = [&](double sum) {
+        if (std::abs(sum - expected_dot) > 1e-9 * std::abs(expected_dot)) {
+            correct = false;
+        }
+    };
+
+    {
+        std::stringstream ss;
+        ss << n << " doubles per array, " << trials << " trials, " << max_threads << " threads; poly "
+           << kPolyCost.flops_per_element / kPolyCost.bytes_per_element << " FLOP/B, triad "
+           << kTriadCost.flops_per_element / kTriadCost.bytes_per_element << " FLOP/B, dot "
+           << kDotCost.flops_per_element / kDotCost.bytes_per_element << " FLOP/B\n";
+        ss << "-- ISA variants (auto_partitioner, all threads) --\n";
+        std::cout << ss.str() << std::flush;
+    }
+    Rate best_poly{}, best_dot{};
+    double best_stream_gbps = 0.0;
+    for (Kernel kernel : {Kernel::Poly, Kernel::Triad, Kernel::Dot}) {
+        for (const KernelSet& set : sets) {
+            Rate rate = run_kernel(kernel, set, kAutoSchedule, data, trials, check_dot);
+            if (kernel == Kernel::Poly && rate.gflops > best_poly.gflops) {
+                best_poly = rate;
+            }
+            if (kernel == Kernel::Dot && rate.gflops > best_dot.gflops) {
+                best_dot = rate;
+            }
+            if (kernel != Kernel::Poly) {
+                best_stream_gbps = std::max(best_stream_gbps, rate.gbps);
+            }
+            std::stringstream ss;
+            ss << "  " << kernel_name(kernel) << " " << std::left << std::setw(10) << set.name << std::right
+               << format_rate(rate) << "\n";
+            std::cout << ss.str() << std::flush;
+        }
+    }
+
+    if (!quick) {
+        const Schedule schedules[] = {
+            {Schedule::Partitioner::Auto, 1, "auto"},
+            {Schedule::Partitioner::Simple, 1024, "simple, grain 1K"},
+            {Schedule::Partitioner::Simple, 65536, "simple, grain 64K"},
+            {Schedule::Partitioner::Static, 1, "static"},
+        };
+        std::cout << "-- Partitioner and grain size (" << widest.name << ", all threads) --\n";
+        for (Kernel kernel : {Kernel::Poly, Kernel::Triad, Kernel::Dot}) {
+            for (const Schedule& schedule : schedules) {
+                Rate rate = run_kernel(kernel, widest, schedule, data, trials, check_dot);
+                std::stringstream ss;
+                ss << "  " << kernel_name(kernel) << " " << std::left << std::setw(18) << schedule.name
+                   << std::right << format_rate(rate) << "\n";
+                std::cout << ss.str() << std::flush;
+            }
+        }
+
+        std::cout << "-- Thread scaling (" << widest.name << ", auto_partitioner) --\n";
+        std::vector<int> thread_counts;
+        for (int t = 1; t < max_threads; t *= 2) {
+            thread_counts.push_back(t);
+        }
+        thread_counts.push_back(max_threads);
+        for (int threads : thread_counts) {
+            tbb::global_control limit(tbb::global_control::max_allowed_parallelism, threads);
+            std::stringstream ss;
+            ss << "  " << threads << (threads == 1 ? " thread:\n" : " threads:\n");
+            for (Kernel kernel : {Kernel::Poly, Kernel::Triad, Kernel::Dot}) {
+                ss << "    " << kernel_name(kernel) << " "
+                   << format_rate(run_kernel(kernel, widest, kAutoSchedule, data, trials, check_dot)) << "\n";
+            }
+#if HAS_PARALLEL_STL
+            Rate pstl = measure_rate(kDotCost, n, trials, [&] {
+                check_dot(std::transform_reduce(std::execution::par_unseq, data.b.get(), data.b.get() + n,
+                                                data.c.get(), 0.0));
+            });
+            ss << "    dot   (std::transform_reduce, par_unseq) " << format_rate(pstl) << "\n";
+#endif
+            std::cout << ss.str() << std::flush;
+        }
+    }
+
+    // Roofline: at the best streaming bandwidth a kernel could reach
+    // intensity x GB/s. Falling well short of that means the FPUs, not
+    // memory, are the limit.
+    auto verdict = [best_stream_gbps](const char* name, const KernelCost& cost, const Rate& measured) {
+        const double roof = cost.flops_per_element / cost.bytes_per_element * best_stream_gbps;
+        std::stringstream ss;
+        ss.setf(std::ios::fixed);
+        ss.precision(2);
+        ss << "  " << name << " roof " << roof << " GFLOP/s, measured " << measured.gflops << ": "
+           << (measured.gflops < 0.5 * roof ? "compute-bound" : "bandwidth-bound") << "\n";
+        return ss.str();
+    };
+    std::stringstream ss;
+    ss.setf(std::ios::fixed);
+    ss.precision(2);
+    ss << "Memory roof at " << best_stream_gbps << " GB/s (best of triad / dot):\n"
+       << verdict("poly", kPolyCost, best_poly) << verdict("dot ", kDotCost, best_dot);
+    if (!correct) {
+        ss << "ERROR: a parallel dot product disagrees with the sequential one\n";
+    }
+    std::cout << ss.str() << std::flush;
+    return correct ? 0 : 1;
+}
+
 void benchmark() {
     std::cout << "\n=== Example 5: Performance Benchmark ===\n";
-    
-    const int N = 10000000;
-    std::vector<double> data(N);
-    
-    // Sequential
-    auto start = std::chrono::high_resolution_clock::now();
-    for (int i = 0; i < N; ++i) {
-        data[i] = std::sqrt(i) * std::sin(i * 0.001);
+    run_kernel_suite(true);
+}
+
+// Multi-publisher contention: P threads call publish_parallel on one broker
+// with eight cheap subscribers
+template<typename Broker>
+double publishes_per_sec(size_t publishers, int total_events) {
+    Broker broker;
+    ShardedCounter delivered; // A shared atomic here would be the bottleneck being measured
+    for (int i = 0; i < 8; ++i) {
+        broker.subscribe([&delivered](const MarketData& data) {
+            delivered.add(data.price > 0 ? 1 : 0);
+        });
     }
-    auto end = std::chrono::high_resolution_clock::now();
-    auto seq_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    
-    std::cout << "Sequential: " << seq_time.count() << "ms\n";
-    
-    // Parallel with TBB
-    start = std::chrono::high_resolution_clock::now();
-    tbb::parallel_for(tbb::blocked_range<int>(0, N),
-        [&data](const tbb::blocked_range<int>& r) {
-            for (int i = r.begin(); i != r.end(); ++i) {
-                data[i] = std::sqrt(i) * std::sin(i * 0.001);
+
+    const int per_publisher = total_events / static_cast<int>(publishers);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < publishers; ++p) {
+        threads.emplace_back([&broker, per_publisher] {
+            for (int i = 0; i < per_publisher; ++i) {
+                broker.publish_parallel({"AAPL", 175.50});
             }
         });
-    end = std::chrono::high_resolution_clock::now();
-    auto par_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    
-    std::cout << "Parallel (TBB): " << par_time.count() << "ms\n";
-    std::cout << "Speedup: " << (double)seq_time.count() / par_time.count() << "x\n";
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return per_publisher * publishers / elapsed.count();
 }
 
-int main() {
+int run_contention_benchmark() {
+    std::cout << "=== TBBEventBroker multi-publisher contention: RCU snapshot vs mutex + copy ===\n"
+              << "(hardware threads: " << std::thread::hardware_concurrency() << ")\n";
+    const int total_events = 40000;
+    for (size_t publishers : {1, 2, 4, 8}) {
+        double rcu = publishes_per_sec<TBBEventBroker<MarketData>>(publishers, total_events);
+        double locked = publishes_per_sec<LockedTBBEventBroker<MarketData>>(publishers, total_events);
+        std::stringstream ss;
+        ss << "  " << publishers << " publishers: RCU " << static_cast<long>(rcu)
+           << " publishes/s, mutex + copy " << static_cast<long>(locked) << " publishes/s\n";
+        std::cout << ss.str() << std::flush;
+    }
+    return 0;
+}
+
+// --bench-json: producers publish workload.ops events of event_bytes to
+// `subscribers` callbacks of task_ns work each, fanned out by
+// parallel_for_each with at most workload.consumers threads; latency is
+// publish -> callback start
+template<template<typename> class Broker>
+void measure_broker(BenchReport& report, const char* variant) {
+    const Workload& load = report.workload();
+    with_event_size(load.event_bytes, [&](auto bytes) {
+        using Event = BenchPayload<decltype(bytes)::value>;
+        report.measure("TBBEventBroker", variant, [&](TrialTimer& timer, LatencyRecorder& latency) {
+            tbb::global_control limit(tbb::global_control::max_allowed_parallelism, load.consumers);
+            Broker<Event> broker;
+            for (size_t s = 0; s < load.subscribers; ++s) {
+                broker.subscribe([&latency, work = load.task_ns](const Event& event) {
+                    latency.record(latency_now() - event.sent_ns);
+                    busy_work(work);
+                });
+            }
+            timer.start();
+            std::vector<std::thread> producers;
+            for (size_t p = 0; p < load.producers; ++p) {
+                producers.emplace_back([&, p] {
+                    Event event{};
+                    for (uint64_t i = share_of(load.ops, load.producers, p); i > 0; --i) {
+                        event.sent_ns = latency_now();
+                        broker.publish_parallel(event);
+                    }
+                });
+            }
+            for (auto& producer : producers) {
+                producer.join();
+            }
+            timer.stop();
+        });
+    });
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        return run_contention_benchmark();
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-json") {
+        return run_bench_json(argc, argv, 2, "08_onetbb_examples", [](BenchReport& report) {
+            measure_broker<TBBEventBroker>(report, "RCU snapshot");
+            measure_broker<LockedTBBEventBroker>(report, "mutex + copy");
+        });
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-kernels") {
+        std::cout << "=== Kernel suite: scalar vs SIMD, partitioners, thread scaling ===\n";
+        return run_kernel_suite(false);
+    }
+
     std::cout << "=== OneTBB Examples ===\n";
     std::cout << "Hardware concurrency: " << std::thread::hardware_concurrency() << "\n";
     
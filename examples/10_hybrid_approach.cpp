@@ -1,6 +1,8 @@
 // Example 10: Hybrid Approach - Thread Pool + Lock-Free Queue + Pub/Sub
 // Demonstrates combining multiple techniques for a high-performance system
 // Topics: Integration of thread pool, lock-free structures, and event-driven design
+//
+// Compile with: g++ -std=c++20 -pthread 10_hybrid_approach.cpp -o hybrid
 
 #include <iostream>
 #include <sstream>
@@ -11,6 +13,65 @@
 #include <vector>
 #include <chrono>
 #include <string>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+#include <span>
+#include <ctime>
+#include <stdexcept>
+#include <utility>
+#include <unordered_map>
+#include <string_view>
+#include <cstdlib>
+#include <new>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <latch>
+#include <optional>
+#include <filesystem>
+#include <cstring>
+#include <system_error>
+#include <exception>
+
+#include "bench_harness.h"
+#include "inline_task.h"
+#include "node_arena.h"
+#include "rcu_snapshot.h"
+#include "symbol_table.h"
+#include "thread_slot_cache.h"
+#include "event_envelope.h"
+#include "latency_histogram.h"
+#include "sharded_counter.h"
+#include "task_priority.h"
+#include "topology.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+// Optional oneTBB engine for the trading pipeline: CMake defines
+// HYBRID_WITH_TBB and links TBB when it finds it
+#if defined(HYBRID_WITH_TBB) && HYBRID_WITH_TBB && __has_include(<tbb/parallel_pipeline.h>)
+#include <tbb/concurrent_queue.h>
+#include <tbb/info.h>
+#include <tbb/parallel_pipeline.h>
+#include <tbb/task_arena.h>
+#define HAS_TBB 1
+#else
+#define HAS_TBB 0
+#endif
+
+// Memory-mapped event journal (POSIX)
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAS_MMAP 1
+#else
+#define HAS_MMAP 0
+#endif
 
 // Lock-free SPSC (Single Producer Single Consumer) Queue
 template<typename T, size_t Size = 1024>
@@ -54,249 +115,3775 @@ public:
     }
 };
 
-// Worker thread for thread pool
-class Worker {
+// High-throughput SPSC Queue
+// Each side keeps a cached copy of the other side's index and only reloads it
+// when the cache says full (producer) or empty (consumer), so the shared index
+// cache lines move between cores once per wrap rather than once per item.
+// Indices run freely and are masked, which requires a power-of-two Size.
+template<typename T, size_t Size = 1024>
+class CachedSPSCQueue {
+    static_assert((Size & (Size - 1)) == 0, "Size must be a power of two");
+    static constexpr size_t Mask = Size - 1;
+
 private:
-    std::thread thread;
-    SPSCQueue<std::function<void()>> tasks;
-    std::atomic<bool> running{true};
+    struct alignas(64) { // Written by the producer
+        std::atomic<size_t> tail{0};
+        size_t cached_head = 0;
+    } producer;
 
-    void run() {
-        std::function<void()> task;
-        while (running.load(std::memory_order_acquire)) {
-            if (tasks.dequeue(task)) {
-                task();
-            } else {
-                std::this_thread::yield();
-            }
+    struct alignas(64) { // Written by the consumer
+        std::atomic<size_t> head{0};
+        size_t cached_tail = 0;
+    } consumer;
+
+    T buffer[Size];
+
+    size_t free_slots(size_t tail) {
+        size_t free = Size - (tail - producer.cached_head);
+        if (free == 0) {
+            producer.cached_head = consumer.head.load(std::memory_order_acquire);
+            free = Size - (tail - producer.cached_head);
         }
-        
-        // Drain remaining tasks
-        while (tasks.dequeue(task)) {
-            task();
+        return free;
+    }
+
+    size_t used_slots(size_t head) {
+        size_t used = consumer.cached_tail - head;
+        if (used == 0) {
+            consumer.cached_tail = producer.tail.load(std::memory_order_acquire);
+            used = consumer.cached_tail - head;
         }
+        return used;
     }
 
 public:
-    Worker() : thread(&Worker::run, this) {}
+    bool enqueue(const T& item) {
+        T copy = item;
+        return enqueue(std::move(copy));
+    }
 
-    ~Worker() {
-        running.store(false, std::memory_order_release);
-        if (thread.joinable()) {
-            thread.join();
+    bool enqueue(T&& item) {
+        size_t tail = producer.tail.load(std::memory_order_relaxed);
+        if (free_slots(tail) == 0) {
+            return false; // Queue full
+        }
+        buffer[tail & Mask] = std::move(item);
+        producer.tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Moves up to count items in, publishing them with one release store.
+    // Returns how many were enqueued.
+    size_t try_enqueue_bulk(T* items, size_t count) {
+        size_t tail = producer.tail.load(std::memory_order_relaxed);
+        size_t n = std::min(count, free_slots(tail));
+        for (size_t i = 0; i < n; ++i) {
+            buffer[(tail + i) & Mask] = std::move(items[i]);
+        }
+        if (n > 0) {
+            producer.tail.store(tail + n, std::memory_order_release);
         }
+        return n;
     }
 
-    bool submit(std::function<void()>&& task) {
-        return tasks.enqueue(task);
+    bool dequeue(T& item) {
+        size_t head = consumer.head.load(std::memory_order_relaxed);
+        if (used_slots(head) == 0) {
+            return false; // Queue empty
+        }
+        item = std::move(buffer[head & Mask]);
+        consumer.head.store(head + 1, std::memory_order_release);
+        return true;
     }
 
-    Worker(const Worker&) = delete;
-    Worker& operator=(const Worker&) = delete;
+    // Moves up to max_count items out, releasing their slots with one store.
+    // Returns how many were dequeued.
+    size_t try_dequeue_bulk(T* items, size_t max_count) {
+        size_t head = consumer.head.load(std::memory_order_relaxed);
+        size_t n = std::min(max_count, used_slots(head));
+        for (size_t i = 0; i < n; ++i) {
+            items[i] = std::move(buffer[(head + i) & Mask]);
+        }
+        if (n > 0) {
+            consumer.head.store(head + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    bool empty() const {
+        return consumer.head.load(std::memory_order_acquire) ==
+               producer.tail.load(std::memory_order_acquire);
+    }
 };
 
-// High-performance thread pool with lock-free per-worker queues
-class LockFreeThreadPool {
+// Bounded MPMC (Multi Producer Multi Consumer) Queue (Vyukov)
+// Every cell carries a sequence number that tells producers and consumers
+// whose turn it is, so the only shared RMW is one CAS on the position counter.
+template<typename T, size_t Size = 1024>
+class MPMCQueue {
+    static_assert((Size & (Size - 1)) == 0, "Size must be a power of two");
+
 private:
-    std::vector<std::unique_ptr<Worker>> workers;
-    std::atomic<size_t> next_worker{0};
+    struct alignas(64) Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    Cell buffer[Size];
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) std::atomic<size_t> dequeue_pos{0};
 
 public:
-    explicit LockFreeThreadPool(size_t num_threads = std::thread::hardware_concurrency()) {
-        for (size_t i = 0; i < num_threads; ++i) {
-            workers.push_back(std::make_unique<Worker>());
+    MPMCQueue() {
+        for (size_t i = 0; i < Size; ++i) {
+            buffer[i].sequence.store(i, std::memory_order_relaxed);
         }
-        std::cout << "[ThreadPool] Created with " << num_threads << " workers\n";
     }
 
-    template<typename F>
-    bool submit(F&& task) {
-        // Round-robin distribution
-        size_t start = next_worker.fetch_add(1, std::memory_order_relaxed) % workers.size();
-        
-        // Try to submit to the selected worker
-        for (size_t i = 0; i < workers.size(); ++i) {
-            size_t index = (start + i) % workers.size();
-            if (workers[index]->submit(std::forward<F>(task))) {
-                return true;
+    bool enqueue(T&& item) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &buffer[pos & (Size - 1)];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                // Cell is free for this lap: claim it
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                                      std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // Queue full
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
             }
         }
-        
-        return false; // All queues full
+
+        cell->data = std::move(item);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
     }
 
-    size_t worker_count() const {
-        return workers.size();
+    bool dequeue(T& item) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &buffer[pos & (Size - 1)];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                                                      std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // Queue empty
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        item = std::move(cell->data);
+        // Hand the cell to the producer one lap ahead
+        cell->sequence.store(pos + Size, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return dequeue_pos.load(std::memory_order_acquire) ==
+               enqueue_pos.load(std::memory_order_acquire);
+    }
+
+    // Items queued; only a hint while other threads are active
+    size_t size_hint() const {
+        const size_t head = dequeue_pos.load(std::memory_order_relaxed);
+        const size_t tail = enqueue_pos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
     }
 };
 
-// High-performance event broker using thread pool
-template<typename Event>
-class HighPerfEventBroker {
+// Per-worker task inbox: an SPSC ring when the worker has exactly one
+// producer and is its only consumer, an MPMC ring when several producers
+// share it or peers may steal from it
+template<typename T, size_t Size = 1024>
+class WorkerInbox {
+private:
+    std::unique_ptr<CachedSPSCQueue<T, Size>> single;
+    std::unique_ptr<MPMCQueue<T, Size>> shared;
+
 public:
-    using Callback = std::function<void(const Event&)>;
+    WorkerInbox(size_t producers, bool stealable) {
+        if (producers > 1 || stealable) {
+            shared = std::make_unique<MPMCQueue<T, Size>>();
+        } else {
+            single = std::make_unique<CachedSPSCQueue<T, Size>>();
+        }
+    }
 
-private:
-    struct SubscriberNode {
-        Callback callback;
-        std::shared_ptr<SubscriberNode> next;
+    bool enqueue(T&& item) {
+        return single ? single->enqueue(std::move(item)) : shared->enqueue(std::move(item));
+    }
+
+    bool dequeue(T& item) {
+        return single ? single->dequeue(item) : shared->dequeue(item);
+    }
+
+    bool empty() const {
+        return single ? single->empty() : shared->empty();
+    }
+
+    // Queued tasks a thief could take (always 0 for an SPSC inbox)
+    size_t stealable_hint() const {
+        return shared ? shared->size_hint() : 0;
+    }
+
+    bool is_shared() const {
+        return shared != nullptr;
+    }
+};
+
+// How LockFreeThreadPool distributes work between its workers
+enum class SchedulingPolicy {
+    RoundRobin,   // Each worker only runs tasks submitted to its own queue
+    WorkStealing  // Idle workers take queued tasks from random victims' inboxes
+};
+
+// Spin-wait hint: lets the sibling hyperthread run and saves power
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// What a worker does when it finds no work
+struct IdlePolicy {
+    enum class Mode {
+        BusyPoll,    // Keep polling with yield(); lowest wake-up latency, burns a core
+        SpinThenPark // Spin, then yield, then sleep on a futex until notified
     };
 
-    // Using shared_ptr directly with atomic operations for MSVC compatibility
-    std::shared_ptr<SubscriberNode> head;
-    LockFreeThreadPool& pool;
-    std::atomic<uint64_t> events_published{0};
-    std::atomic<uint64_t> callbacks_executed{0};
+    Mode mode = Mode::SpinThenPark;
+    uint32_t spin_iterations = 2000; // cpu_relax() polls before yielding
+    uint32_t yield_iterations = 50;  // yield() polls before parking
 
-public:
-    explicit HighPerfEventBroker(LockFreeThreadPool& thread_pool) 
-        : head(nullptr), pool(thread_pool) {}
+    static IdlePolicy busy_poll() {
+        return IdlePolicy{Mode::BusyPoll, 0, 0};
+    }
+};
 
-    // Lock-free subscribe
-    void subscribe(Callback callback) {
-        auto new_node = std::make_shared<SubscriberNode>();
-        new_node->callback = std::move(callback);
-        
-        auto old_head = std::atomic_load_explicit(&head, std::memory_order_acquire);
-        do {
-            new_node->next = old_head;
-        } while (!std::atomic_compare_exchange_weak_explicit(
-            &head, &old_head, new_node,
-            std::memory_order_release,
-            std::memory_order_acquire));
+// What submit() does when every inbox it may use is full
+struct OverflowPolicy {
+    enum class Mode {
+        Reject,     // Return false; the caller decides
+        BlockSpin,  // Retry: spin, then yield, then give up and reject
+        Spill,      // Park the task in an unbounded queue (one per lane) shared by the workers
+        DropOldest, // Like Spill, but bounded: the oldest parked task of the lane is discarded
+        RunInline   // Run the task on the submitting thread
+    };
+
+    Mode mode = Mode::BlockSpin;
+    uint32_t spin_iterations = 1000;     // BlockSpin: cpu_relax() retries before yielding
+    uint32_t yield_iterations = 100000;  // BlockSpin: yield() retries before rejecting
+    size_t drop_capacity = 4096;         // DropOldest: parked tasks kept per lane
+
+    static OverflowPolicy with(Mode mode) {
+        OverflowPolicy policy;
+        policy.mode = mode;
+        return policy;
     }
+};
 
-    // Lock-free publish with parallel dispatch
-    void publish(const Event& event) {
-        events_published.fetch_add(1, std::memory_order_relaxed);
-        
-        auto node = std::atomic_load_explicit(&head, std::memory_order_acquire);
-        while (node) {
-            // Dispatch each callback to thread pool
-            pool.submit([cb = node->callback, event, this]() {
-                cb(event);
-                callbacks_executed.fetch_add(1, std::memory_order_relaxed);
-            });
-            node = node->next;
+// How often the overflow policy fired, summed over producers. Size inboxes
+// from these rather than guessing: any non-zero count means a full queue.
+struct OverflowStats {
+    uint64_t rejected = 0;   // submit() returned false
+    uint64_t blocked = 0;    // Submits that had to wait for a free slot
+    uint64_t spilled = 0;    // Tasks parked in the overflow queue
+    uint64_t dropped = 0;    // Parked tasks discarded unrun
+    uint64_t ran_inline = 0; // Tasks run by the submitting thread
+
+    uint64_t total() const {
+        return rejected + blocked + spilled + dropped + ran_inline;
+    }
+};
+
+// Lets drain() sleep on a futex (std::atomic::wait) instead of spinning.
+// Workers only bump the epoch and notify while somebody is waiting.
+struct CompletionSignal {
+    std::atomic<uint32_t> waiters{0};
+    std::atomic<uint32_t> epoch{0};
+
+    void notify() {
+        // seq_cst pairs with the waiter's seq_cst increment + counter reads:
+        // either we see the waiter, or the waiter sees our completion
+        if (waiters.load(std::memory_order_seq_cst) > 0) {
+            epoch.fetch_add(1, std::memory_order_release);
+            epoch.notify_all();
         }
     }
+};
 
-    uint64_t get_events_published() const {
-        return events_published.load(std::memory_order_relaxed);
+// Unbounded queue shared by all workers of a pool, one per priority lane,
+// used by the Spill and DropOldest overflow policies. It is only touched once an inbox is full, so
+// a mutex is fine; workers read the atomic size before taking the lock.
+template<typename Job>
+class OverflowQueue {
+private:
+    std::mutex mutex;
+    std::deque<Job> jobs;
+    std::atomic<size_t> count{0};
+
+public:
+    // With a capacity, the oldest job is moved into dropped (and true
+    // returned) when the queue would grow past it
+    bool push(Job&& job, size_t capacity, Job& dropped) {
+        std::lock_guard<std::mutex> lock(mutex);
+        bool full = capacity > 0 && jobs.size() >= capacity;
+        if (full) {
+            dropped = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        jobs.push_back(std::move(job));
+        count.store(jobs.size(), std::memory_order_release);
+        return full;
     }
 
-    uint64_t get_callbacks_executed() const {
-        return callbacks_executed.load(std::memory_order_relaxed);
+    bool pop(Job& job) {
+        if (empty()) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (jobs.empty()) {
+            return false;
+        }
+        job = std::move(jobs.front());
+        jobs.pop_front();
+        count.store(jobs.size(), std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return count.load(std::memory_order_acquire) == 0;
     }
 };
 
-// Example application: Real-time trading system
-struct MarketTick {
-    std::string symbol;
-    double price;
-    uint64_t timestamp;
-    int volume;
+// The queues of one priority lane that all workers of a pool share: the
+// inbox of threads that submit without a producer slot (see
+// PoolConfig::producers) and the spill queue of the Spill / DropOldest
+// overflow policies
+template<typename Job>
+struct SharedLane {
+    MPMCQueue<Job> guests;
+    OverflowQueue<Job> spill;
+
+    bool empty() const {
+        return guests.empty() && spill.empty();
+    }
 };
 
-class TradingSystem {
+// A task as it waits in a lane: its priority, when it was submitted (for
+// the lane's queue-delay histogram, 0 if not recorded) and the latency_now()
+// time by which it must start (0 = no deadline)
+template<typename Task>
+struct LaneTask {
+    Task task;
+    uint64_t submitted = 0;
+    uint64_t deadline = 0;
+    TaskPriority priority = TaskPriority::Normal;
+
+    void operator()() {
+        task();
+    }
+};
+
+// What a worker does with a task that is still queued past its deadline
+enum class ExpiryAction {
+    Run,   // Run it anyway, late
+    Drop,  // Discard it unrun; drain() counts it as finished
+    Defer  // Park it behind every lane and run it once the worker has nothing else
+};
+
+// Priority lanes of a LockFreeThreadPool: each worker has one inbox per
+// TaskPriority and serves them in LanePolicy order (task_priority.h)
+struct LaneConfig {
+    LanePolicy order{};
+    std::array<ExpiryAction, kPriorityLanes> on_expiry{ExpiryAction::Run, ExpiryAction::Defer, ExpiryAction::Drop};
+    bool record_queue_delay = true; // Per-lane histogram of submit -> start (two clock reads per task)
+};
+
+// Per-lane counters and queue delay, merged over workers
+struct LaneStats {
+    uint64_t expired_dropped = 0;  // Missed their deadline, discarded (ExpiryAction::Drop)
+    uint64_t expired_deferred = 0; // Missed their deadline, run after everything else (ExpiryAction::Defer)
+    LatencyHistogram queue_delay;  // Submit -> start, in ns
+};
+
+// Worker thread for thread pool
+// Task is the stored callable type: std::function<void()> or an allocation-free
+// InlineTask<N>. Queue slots are moved from, so move-only tasks are fine.
+//
+// Lanes: workers pick the next task from their lane inboxes in LanePolicy
+// order. WorkStealing: a lane's turn also looks at the same lane of the
+// peers, so an idle worker takes queued tasks (of any priority, in
+// priority order) straight out of the inbox of a peer stuck in a slow
+// callback. The inboxes are then MPMC rings and tasks are stolen by value.
+template<typename Task>
+class Worker {
 private:
-    LockFreeThreadPool pool;
-    HighPerfEventBroker<MarketTick> market_broker;
+    using Job = LaneTask<Task>;
 
-    std::atomic<int> signals_generated{0};
-    std::atomic<int> risks_checked{0};
-    std::atomic<int> trades_logged{0};
+    std::thread thread;
+    // All queues are allocated by the worker thread itself, after it has
+    // been pinned, so that their pages are first touched on its own node
+    std::array<std::optional<WorkerInbox<Job>>, kPriorityLanes> lanes;
+    LaneSelector selector;
+    std::array<ExpiryAction, kPriorityLanes> on_expiry{};
+    const size_t inbox_producers;
+    const bool stealing;
+    const WorkerPlacement placement;
+    std::atomic<bool> running{true};
+    alignas(64) std::atomic<uint64_t> completed{0}; // Written only by this worker
+    // Parking: producers read `sleeping` on every submit, but only touch
+    // wake_seq (and make a futex syscall) when the worker is really asleep
+    alignas(64) std::atomic<bool> sleeping{false};
+    std::atomic<uint32_t> wake_seq{0};
+    const std::vector<std::unique_ptr<Worker>>* peers = nullptr;
+    SharedLane<Job>* shared = nullptr;      // One per lane, shared by the pool's workers
+    OverflowQueue<Job>* deferred = nullptr; // Expired tasks (ExpiryAction::Defer), also shared
+    LatencyRecorder* task_time = nullptr;   // Null when not recording
+    LatencyRecorder* queue_delay = nullptr; // One per lane; null when not recording
+    CompletionSignal* completion = nullptr;
+    IdlePolicy idle_policy;
+    size_t index = 0;
+    // Written only by this worker
+    std::array<std::atomic<uint64_t>, kPriorityLanes> expired_dropped{};
+    std::array<std::atomic<uint64_t>, kPriorityLanes> expired_deferred{};
 
-public:
-    TradingSystem(size_t threads = std::thread::hardware_concurrency()) 
-        : pool(threads), market_broker(pool) {
-        
-        // Subscribe strategy
-        market_broker.subscribe([this](const MarketTick& tick) {
-            // Simulate strategy processing
-            if (tick.price > 150.0) {
-                signals_generated.fetch_add(1, std::memory_order_relaxed);
+    bool lanes_empty() const {
+        for (const auto& lane : lanes) {
+            if (!lane->empty()) {
+                return false;
             }
-            std::this_thread::sleep_for(std::chrono::microseconds(10));
-        });
+        }
+        return true;
+    }
 
-        // Subscribe risk engine
-        market_broker.subscribe([this](const MarketTick& tick) {
-            // Simulate risk check
-            if (tick.volume > 1000) {
-                risks_checked.fetch_add(1, std::memory_order_relaxed);
+    bool has_work() const {
+        if (!lanes_empty() || !deferred->empty()) {
+            return true;
+        }
+        for (size_t lane = 0; lane < kPriorityLanes; ++lane) {
+            if (!shared[lane].empty()) {
+                return true;
             }
-            std::this_thread::sleep_for(std::chrono::microseconds(15));
-        });
+        }
+        if (stealing) {
+            for (const auto& peer : *peers) {
+                if (!peer->lanes_empty()) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
 
-        // Subscribe logger
-        market_broker.subscribe([this](const MarketTick& tick) {
-            // Simulate logging
-            trades_logged.fetch_add(1, std::memory_order_relaxed);
-            std::this_thread::sleep_for(std::chrono::microseconds(5));
-        });
+    // Called after a failed poll; idle_rounds counts consecutive failures
+    void idle(uint32_t& idle_rounds) {
+        if (idle_policy.mode == IdlePolicy::Mode::BusyPoll) {
+            std::this_thread::yield();
+            return;
+        }
+        if (idle_rounds < idle_policy.spin_iterations) {
+            ++idle_rounds;
+            cpu_relax();
+            return;
+        }
+        if (idle_rounds < idle_policy.spin_iterations + idle_policy.yield_iterations) {
+            ++idle_rounds;
+            std::this_thread::yield();
+            return;
+        }
 
-        std::cout << "[TradingSystem] Initialized with " 
-                  << pool.worker_count() << " workers\n";
+        // Announce, then re-check: a producer that enqueued before seeing the
+        // flag is caught by the re-check, one that enqueued after will wake us
+        uint32_t seq = wake_seq.load(std::memory_order_acquire);
+        sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!has_work() && running.load(std::memory_order_acquire)) {
+            wake_seq.wait(seq, std::memory_order_acquire);
+        }
+        sleeping.store(false, std::memory_order_relaxed);
+        idle_rounds = 0;
     }
 
-    void process_tick(const MarketTick& tick) {
-        market_broker.publish(tick);
+    void wake() {
+        wake_seq.fetch_add(1, std::memory_order_release);
+        wake_seq.notify_one();
     }
 
-    void print_stats() {
-        std::cout << "\n=== Trading System Statistics ===\n";
-        std::cout << "Events published: " << market_broker.get_events_published() << "\n";
-        std::cout << "Callbacks executed: " << market_broker.get_callbacks_executed() << "\n";
-        std::cout << "Signals generated: " << signals_generated.load() << "\n";
-        std::cout << "Risks checked: " << risks_checked.load() << "\n";
-        std::cout << "Trades logged: " << trades_logged.load() << "\n";
+    void finish() {
+        completed.fetch_add(1, std::memory_order_seq_cst);
+        completion->notify();
     }
-};
 
-int main() {
-    std::cout << "=== Hybrid Approach: High-Performance Trading System ===\n";
-    std::cout << "Combining:\n";
-    std::cout << "  - Lock-free thread pool with per-worker queues\n";
-    std::cout << "  - Lock-free publisher/subscriber with RCU\n";
-    std::cout << "  - Parallel event dispatch\n\n";
+    // Applies the lane's ExpiryAction; true if the task was dropped or
+    // deferred instead of being run now
+    bool retire_expired(Job& task) {
+        const size_t lane = lane_of(task.priority);
+        switch (on_expiry[lane]) {
+        case ExpiryAction::Run:
+            return false;
+        case ExpiryAction::Drop:
+            expired_dropped[lane].fetch_add(1, std::memory_order_relaxed);
+            finish();
+            return true;
+        case ExpiryAction::Defer: {
+            expired_deferred[lane].fetch_add(1, std::memory_order_relaxed);
+            task.deadline = 0; // Runs whenever it comes out of the deferred queue
+            Job unused;
+            deferred->push(std::move(task), 0, unused);
+            return true;
+        }
+        }
+        return false;
+    }
 
-    TradingSystem system(4);
+    void execute(Job& task) {
+        const bool timed = task_time || queue_delay || task.deadline != 0;
+        const uint64_t start = timed ? latency_now() : 0;
+        if (task.deadline != 0 && start > task.deadline && retire_expired(task)) {
+            return;
+        }
+        if (queue_delay && task.submitted != 0) {
+            queue_delay[lane_of(task.priority)].record(start - task.submitted);
+        }
+        task();
+        if (task_time) {
+            task_time->record(latency_now() - start);
+        }
+        finish();
+    }
 
-    std::cout << "--- Simulating Market Data Feed ---\n";
-    auto start = std::chrono::high_resolution_clock::now();
+    // More than one task is up for grabs: make sure a parked peer can help
+    void wake_one_peer() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (const auto& peer : *peers) {
+            if (peer.get() != this && peer->sleeping.load(std::memory_order_relaxed)) {
+                peer->wake();
+                return;
+            }
+        }
+    }
 
-    // Simulate incoming market data
-    std::vector<std::string> symbols = {"AAPL", "GOOGL", "MSFT", "AMZN"};
-    
-    for (int i = 0; i < 1000; ++i) {
-        MarketTick tick{
-            symbols[i % symbols.size()],
-            140.0 + (i % 50),
-            static_cast<uint64_t>(i),
-            500 + (i % 1000)
-        };
-        
-        system.process_tick(tick);
+    // One task from the same lane of a peer
+    bool steal_from_peer(size_t lane, Job& task, uint32_t& seed) {
+        const size_t count = peers->size();
+        // xorshift32: cheap per-thread random victim selection
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        size_t start = seed % count;
+        // Victims on this worker's node first: their tasks (and what they
+        // capture) were most likely written on this node
+        for (bool same_node : {true, false}) {
+            for (size_t i = 0; i < count; ++i) {
+                size_t victim = (start + i) % count;
+                Worker& peer = *(*peers)[victim];
+                if (victim != index && (peer.placement.node == placement.node) == same_node &&
+                    peer.lanes[lane]->dequeue(task)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // The lanes in LanePolicy order. A lane's turn takes from this worker's
+    // inbox, then (WorkStealing) the peers' inboxes, then the lane's shared
+    // queues: tasks from threads without a producer slot, and overflowed
+    // tasks, which are newer than what the inboxes hold. Expired deferred
+    // tasks come after every lane.
+    bool next_task(Job& task, uint32_t& seed) {
+        return selector.next([&](size_t lane) {
+                   return lanes[lane]->dequeue(task) || (stealing && steal_from_peer(lane, task, seed)) ||
+                          shared[lane].guests.dequeue(task) || shared[lane].spill.pop(task);
+               }) ||
+               deferred->pop(task);
+    }
+
+    void run() {
+        uint32_t seed = static_cast<uint32_t>(index) * 2654435761u + 1;
+        Job task;
+        uint32_t idle_rounds = 0;
+        while (running.load(std::memory_order_acquire)) {
+            if (next_task(task, seed)) {
+                idle_rounds = 0;
+                execute(task);
+            } else {
+                idle(idle_rounds);
+            }
+        }
         
-        if (i % 250 == 0) {
-            std::cout << "  Processed " << i << " ticks...\n";
+        // Drain remaining tasks
+        while (next_task(task, seed)) {
+            execute(task);
         }
     }
 
-    std::cout << "  All ticks submitted (non-blocking)\n";
-    std::cout << "  Waiting for processing to complete...\n";
+    void thread_main(ThreadPinning pinning, std::latch& ready) {
+        apply_placement(placement, pinning);
+        for (auto& lane : lanes) {
+            lane.emplace(inbox_producers, stealing);
+        }
+        // Peers poll each other's inboxes: wait until all of them exist
+        ready.arrive_and_wait();
+        run();
+    }
 
-    // Wait for processing
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+public:
+    Worker(size_t producers, SchedulingPolicy policy, WorkerPlacement where)
+        : inbox_producers(producers), stealing(policy == SchedulingPolicy::WorkStealing), placement(where) {}
 
-    auto end = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    ~Worker() {
+        stop();
+    }
 
-    system.print_stats();
-    
-    std::cout << "\nProcessing time: " << duration.count() << "ms\n";
-    std::cout << "Throughput: " << (1000.0 / duration.count() * 1000) << " ticks/sec\n";
+    // Workers are started only once the whole pool exists, because a
+    // stealing worker may look at any of its peers. Nothing may be
+    // submitted before every worker has arrived at ready.
+    void start(IdlePolicy idle_config, ThreadPinning pinning, const LaneConfig& lane_config,
+               const std::vector<std::unique_ptr<Worker>>& all,
+               size_t self, SharedLane<Job>* pool_lanes, OverflowQueue<Job>& expired, LatencyRecorder* run_time,
+               LatencyRecorder* lane_delay, CompletionSignal& signal, std::latch& ready) {
+        selector = LaneSelector(lane_config.order);
+        on_expiry = lane_config.on_expiry;
+        peers = &all;
+        shared = pool_lanes;
+        deferred = &expired;
+        task_time = run_time;
+        queue_delay = lane_delay;
+        completion = &signal;
+        idle_policy = idle_config;
+        index = self;
+        thread = std::thread(&Worker::thread_main, this, pinning, std::ref(ready));
+    }
+
+    void request_stop() {
+        running.store(false, std::memory_order_release);
+        wake();
+    }
+
+    void stop() {
+        request_stop();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    // Moves from task only when it was accepted. With WorkStealing, a task
+    // that queues behind others on a busy worker also wakes a parked peer,
+    // which then steals from this worker's inbox.
+    bool submit(Job&& task) {
+        WorkerInbox<Job>& inbox = *lanes[lane_of(task.priority)];
+        if (!inbox.enqueue(std::move(task))) {
+            return false;
+        }
+        if (!wake_if_sleeping() && stealing && idle_policy.mode == IdlePolicy::Mode::SpinThenPark &&
+            inbox.stealable_hint() > 1) {
+            wake_one_peer();
+        }
+        return true;
+    }
+
+    // Call after making work visible to this worker; returns true if it was parked
+    bool wake_if_sleeping() {
+        if (idle_policy.mode != IdlePolicy::Mode::SpinThenPark) {
+            return false;
+        }
+        // Pairs with the fence in idle(): either we see the flag or the
+        // worker's re-check sees the task
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!sleeping.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        wake();
+        return true;
+    }
+
+    bool has_shared_inbox() const {
+        return inbox_producers > 1 || stealing;
+    }
+
+    size_t node() const {
+        return placement.node;
+    }
+
+    // Tasks this worker has finished (including ones it stole)
+    uint64_t completed_count() const {
+        return completed.load(std::memory_order_seq_cst);
+    }
+
+    uint64_t expired_dropped_count(size_t lane) const {
+        return expired_dropped[lane].load(std::memory_order_relaxed);
+    }
+
+    uint64_t expired_deferred_count(size_t lane) const {
+        return expired_deferred[lane].load(std::memory_order_relaxed);
+    }
+
+    Worker(const Worker&) = delete;
+    Worker& operator=(const Worker&) = delete;
+};
+
+// Pool configuration. Producers are the threads that call submit(); each
+// one owns a fixed set of workers, so a worker's inbox is an SPSC ring when
+// it has exactly one producer and an MPMC ring when it is shared. Slots go
+// to the first `producers` threads that submit; any later thread (a worker
+// resubmitting from a callback, say) shares one MPMC inbox per lane with
+// the other slot-less threads: slower, and without submit_to() ordering.
+struct PoolConfig {
+    size_t threads = std::thread::hardware_concurrency();
+    SchedulingPolicy scheduling = SchedulingPolicy::RoundRobin;
+    size_t producers = 1;
+    IdlePolicy idle{}; // IdlePolicy::busy_poll() for latency-critical pools
+    OverflowPolicy overflow{};
+    bool record_task_time = true; // Per-worker histogram of task run time (two clock reads per task)
+    ThreadPinning pinning = ThreadPinning::None; // Core / Node: pin workers, see topology.h
+    bool log_creation = true; // Print the "[ThreadPool] Created ..." line
+    LaneConfig lanes{}; // Priority lanes: service order, deadline handling, queue-delay histograms
+};
+
+// High-performance thread pool with lock-free per-worker queues
+template<typename Task>
+class BasicLockFreeThreadPool {
+private:
+    using Job = LaneTask<Task>;
+
+    struct Producer {
+        std::vector<size_t> workers; // Fixed: submit_to() maps keys over these
+        // Round-robin state, only touched by the owning thread: the same
+        // workers with those on the producer's node first, and how many of
+        // them that is. The node is looked up again every kLocalityRecheck
+        // submits, so an unpinned producer that migrates follows along.
+        std::vector<size_t> nearest;
+        size_t local = 0;
+        size_t node = 0;
+        uint32_t until_recheck = 0;
+        size_t next = 0; // Round-robin cursor
+        // Written only by the owning thread, except in the guest producer
+        // that every slot-less thread counts on
+        std::atomic<uint64_t> submitted{0};
+        // Overflow counters, same rule
+        std::atomic<uint64_t> rejected{0};
+        std::atomic<uint64_t> blocked{0};
+        std::atomic<uint64_t> spilled{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> ran_inline{0};
+    };
+
+    std::unique_ptr<std::array<SharedLane<Job>, kPriorityLanes>> shared_lanes;
+    OverflowQueue<Job> deferred_queue;
+    const OverflowPolicy overflow_policy;
+    const bool record_queue_delay;
+    LatencyRecorder task_time;
+    std::array<LatencyRecorder, kPriorityLanes> queue_delay;
+    std::latch workers_ready;
+    std::vector<std::unique_ptr<Worker<Task>>> workers;
+    std::vector<Producer> producers;
+    Producer guest; // Counters of the threads without a slot
+    std::atomic<size_t> registered_producers{0};
+    CompletionSignal completion;
+    const uint64_t pool_id;
+    const SchedulingPolicy scheduling_policy;
+
+    // The slot holders, then the guest producer
+    template<typename F>
+    void for_each_producer(F&& f) const {
+        for (const auto& producer : producers) {
+            f(producer);
+        }
+        f(guest);
+    }
+
+    uint64_t total_submitted() const {
+        uint64_t total = 0;
+        for_each_producer([&](const Producer& producer) {
+            total += producer.submitted.load(std::memory_order_acquire);
+        });
+        return total;
+    }
+
+    // Dropped tasks will never run, so drain() counts them as finished
+    uint64_t total_completed() const {
+        uint64_t total = 0;
+        for (const auto& worker : workers) {
+            total += worker->completed_count();
+        }
+        for_each_producer([&](const Producer& producer) {
+            total += producer.dropped.load(std::memory_order_seq_cst);
+        });
+        return total;
+    }
+
+    static constexpr uint32_t kLocalityRecheck = 1024;
+
+    // Reorders producer.nearest for the node the calling thread is on now
+    void locate(Producer& producer) {
+        producer.until_recheck = kLocalityRecheck;
+        const size_t node = Topology::get().current_node();
+        if (node == producer.node && !producer.nearest.empty()) {
+            return;
+        }
+        producer.node = node;
+        producer.nearest = producer.workers;
+        auto remote = std::stable_partition(producer.nearest.begin(), producer.nearest.end(),
+                                            [&](size_t w) { return workers[w]->node() == node; });
+        producer.local = static_cast<size_t>(remote - producer.nearest.begin());
+    }
+
+    // Same-node workers first; remote ones only once all of those are full
+    bool submit_round_robin(Producer& producer, Job& job) {
+        if (producer.until_recheck-- == 0) {
+            locate(producer);
+        }
+        const size_t local = producer.local;
+        const size_t remote = producer.nearest.size() - local;
+        const size_t cursor = producer.next++;
+        for (size_t i = 0; i < local; ++i) {
+            size_t index = producer.nearest[(cursor + i) % local];
+            if (workers[index]->submit(std::move(job))) { // Only moved from on success
+                return true;
+            }
+        }
+        for (size_t i = 0; i < remote; ++i) {
+            size_t index = producer.nearest[local + (cursor + i) % remote];
+            if (workers[index]->submit(std::move(job))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Every inbox was full. retry(job) makes another attempt at the same
+    // placement; whatever happens is counted on the producer.
+    template<typename Retry>
+    bool overflow_submit(Producer& producer, Job& job, Retry&& retry) {
+        switch (overflow_policy.mode) {
+        case OverflowPolicy::Mode::Reject:
+            break;
+
+        case OverflowPolicy::Mode::BlockSpin: {
+            producer.blocked.fetch_add(1, std::memory_order_relaxed);
+            const uint32_t limit = overflow_policy.spin_iterations + overflow_policy.yield_iterations;
+            for (uint32_t round = 0; round < limit; ++round) {
+                if (round < overflow_policy.spin_iterations) {
+                    cpu_relax();
+                } else {
+                    std::this_thread::yield();
+                }
+                if (retry(job)) {
+                    producer.submitted.fetch_add(1, std::memory_order_release);
+                    return true;
+                }
+            }
+            break;
+        }
+
+        case OverflowPolicy::Mode::Spill:
+        case OverflowPolicy::Mode::DropOldest: {
+            const bool bounded = overflow_policy.mode == OverflowPolicy::Mode::DropOldest;
+            Job dropped;
+            producer.submitted.fetch_add(1, std::memory_order_release);
+            producer.spilled.fetch_add(1, std::memory_order_relaxed);
+            OverflowQueue<Job>& spill_queue = (*shared_lanes)[lane_of(job.priority)].spill;
+            if (spill_queue.push(std::move(job), bounded ? std::max<size_t>(overflow_policy.drop_capacity, 1) : 0,
+                              dropped)) {
+                producer.dropped.fetch_add(1, std::memory_order_seq_cst);
+                completion.notify();
+            }
+            wake_any_worker();
+            return true;
+        }
+
+        case OverflowPolicy::Mode::RunInline:
+            producer.ran_inline.fetch_add(1, std::memory_order_relaxed);
+            job();
+            return true;
+        }
+
+        producer.rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    template<typename F>
+    Job make_job(F&& task, TaskPriority priority, uint64_t deadline) const {
+        return Job{Task(std::forward<F>(task)), record_queue_delay ? latency_now() : 0, deadline, priority};
+    }
+
+    static uint64_t next_pool_id() {
+        static std::atomic<uint64_t> counter{0};
+        return counter.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Work in a shared queue can be run by anyone: wake one parked worker
+    void wake_any_worker() {
+        for (auto& worker : workers) {
+            if (worker->wake_if_sleeping()) {
+                break;
+            }
+        }
+    }
+
+    // The calling thread's producer slot, claimed on its first submit();
+    // null once every slot is taken
+    Producer* this_thread_producer() {
+        static constexpr size_t kNoSlot = ~size_t(0);
+        thread_local std::vector<std::pair<uint64_t, size_t>> slots;
+        for (const auto& [pool, slot] : slots) {
+            if (pool == pool_id) {
+                return slot == kNoSlot ? nullptr : &producers[slot];
+            }
+        }
+
+        size_t slot = registered_producers.fetch_add(1, std::memory_order_relaxed);
+        if (slot >= producers.size()) {
+            slots.emplace_back(pool_id, kNoSlot);
+            return nullptr;
+        }
+        slots.emplace_back(pool_id, slot);
+
+        Producer& producer = producers[slot];
+        locate(producer);
+        return &producer;
+    }
+
+    // A thread without a producer slot: into the lane's shared inbox
+    bool submit_guest(Job& job) {
+        MPMCQueue<Job>& inbox = (*shared_lanes)[lane_of(job.priority)].guests;
+        const auto attempt = [this, &inbox](Job& retry_job) {
+            if (!inbox.enqueue(std::move(retry_job))) { // Only moved from on success
+                return false;
+            }
+            wake_any_worker();
+            return true;
+        };
+        if (attempt(job)) {
+            guest.submitted.fetch_add(1, std::memory_order_release);
+            return true;
+        }
+        return overflow_submit(guest, job, attempt);
+    }
+
+public:
+    explicit BasicLockFreeThreadPool(size_t num_threads = std::thread::hardware_concurrency(),
+                                     SchedulingPolicy policy = SchedulingPolicy::RoundRobin)
+        : BasicLockFreeThreadPool(PoolConfig{num_threads, policy, 1}) {}
+
+    explicit BasicLockFreeThreadPool(const PoolConfig& config)
+        : shared_lanes(std::make_unique<std::array<SharedLane<Job>, kPriorityLanes>>()),
+          overflow_policy(config.overflow),
+          record_queue_delay(config.lanes.record_queue_delay),
+          workers_ready(static_cast<std::ptrdiff_t>(std::max<size_t>(config.threads, 1)) + 1),
+          producers(std::max<size_t>(config.producers, 1)),
+          pool_id(next_pool_id()),
+          scheduling_policy(config.scheduling) {
+        const size_t num_threads = std::max<size_t>(config.threads, 1);
+        const size_t num_producers = producers.size();
+
+        // Fewer producers than workers: split the workers between producers.
+        // More producers than workers: several producers share each worker.
+        std::vector<size_t> producers_per_worker(num_threads, 0);
+        for (size_t p = 0; p < num_producers; ++p) {
+            for (size_t w = 0; w < num_threads; ++w) {
+                bool owned = num_producers <= num_threads ? (w % num_producers == p)
+                                                          : (p % num_threads == w);
+                if (owned) {
+                    producers[p].workers.push_back(w);
+                    ++producers_per_worker[w];
+                }
+            }
+        }
+
+        const std::vector<WorkerPlacement> plan = plan_workers(num_threads, config.pinning);
+        size_t shared_inboxes = 0;
+        for (size_t i = 0; i < num_threads; ++i) {
+            workers.push_back(std::make_unique<Worker<Task>>(producers_per_worker[i], config.scheduling, plan[i]));
+            shared_inboxes += workers.back()->has_shared_inbox() ? 1 : 0;
+        }
+        for (size_t i = 0; i < num_threads; ++i) {
+            workers[i]->start(config.idle, config.pinning, config.lanes, workers, i, shared_lanes->data(),
+                              deferred_queue, config.record_task_time ? &task_time : nullptr,
+                              record_queue_delay ? queue_delay.data() : nullptr, completion, workers_ready);
+        }
+        workers_ready.arrive_and_wait();
+        if (!config.log_creation) {
+            return;
+        }
+
+        std::stringstream ss;
+        ss << "[ThreadPool] Created with " << num_threads << " workers ("
+           << (config.scheduling == SchedulingPolicy::WorkStealing ? "work-stealing" : "round-robin")
+           << ", " << num_threads - shared_inboxes << " SPSC / " << shared_inboxes << " MPMC inboxes";
+        if (config.pinning != ThreadPinning::None) {
+            ss << ", pinned per " << (config.pinning == ThreadPinning::Core ? "core" : "node") << " over "
+               << Topology::get().node_count() << (Topology::get().node_count() == 1 ? " node" : " nodes");
+        }
+        ss << ")\n";
+        std::cout << ss.str() << std::flush;
+    }
+
+    ~BasicLockFreeThreadPool() {
+        // Stop everyone before joining anyone: a stealing worker may still be
+        // reading a peer's inbox
+        for (auto& worker : workers) {
+            worker->request_stop();
+        }
+        for (auto& worker : workers) {
+            worker->stop();
+        }
+    }
+
+    BasicLockFreeThreadPool(const BasicLockFreeThreadPool&) = delete;
+    BasicLockFreeThreadPool& operator=(const BasicLockFreeThreadPool&) = delete;
+
+    // Safe from any thread (see PoolConfig::producers for which ones get a
+    // slot). Returns false only if the task was rejected by the overflow
+    // policy (Reject, or BlockSpin running out of retries).
+    template<typename F>
+    bool submit(F&& task) {
+        return submit(TaskPriority::Normal, std::forward<F>(task));
+    }
+
+    // Into the priority's lane. With a deadline (a latency_now() time), a
+    // task still queued past it is handled by LaneConfig::on_expiry.
+    template<typename F>
+    bool submit(TaskPriority priority, F&& task, uint64_t deadline = 0) {
+        Producer* slot = this_thread_producer();
+        Job job = make_job(std::forward<F>(task), priority, deadline);
+        if (!slot) {
+            return submit_guest(job);
+        }
+        Producer& producer = *slot;
+
+        // Round-robin over this producer's workers
+        if (submit_round_robin(producer, job)) {
+            producer.submitted.fetch_add(1, std::memory_order_release);
+            return true;
+        }
+        return overflow_submit(producer, job, [this, &producer](Job& retry_job) {
+            return submit_round_robin(producer, retry_job);
+        });
+    }
+
+    // Sends the task to a fixed worker chosen by key (modulo this producer's
+    // workers). Under RoundRobin scheduling, tasks submitted with the same
+    // key from the same thread run one at a time, in submission order --
+    // unless one overflows under Spill, DropOldest or RunInline, which
+    // may run it on another thread, or the thread has no producer slot.
+    template<typename F>
+    bool submit_to(size_t key, F&& task) {
+        return submit_to(key, TaskPriority::Normal, std::forward<F>(task));
+    }
+
+    // Ordering holds per key and lane: tasks of different priorities
+    // overtake each other by design
+    template<typename F>
+    bool submit_to(size_t key, TaskPriority priority, F&& task, uint64_t deadline = 0) {
+        Producer* slot = this_thread_producer();
+        Job job = make_job(std::forward<F>(task), priority, deadline);
+        if (!slot) {
+            return submit_guest(job);
+        }
+        Producer& producer = *slot;
+        Worker<Task>& worker = *workers[producer.workers[key % producer.workers.size()]];
+        if (worker.submit(std::move(job))) {
+            producer.submitted.fetch_add(1, std::memory_order_release);
+            return true;
+        }
+        return overflow_submit(producer, job, [&worker](Job& retry_job) {
+            return worker.submit(std::move(retry_job));
+        });
+    }
+
+    // Block until every task submitted before this call has finished.
+    // Sleeps on the completion epoch rather than polling.
+    void drain() {
+        const uint64_t target = total_submitted();
+        completion.waiters.fetch_add(1, std::memory_order_seq_cst);
+        while (true) {
+            uint32_t epoch = completion.epoch.load(std::memory_order_acquire);
+            if (total_completed() >= target) {
+                break;
+            }
+            completion.epoch.wait(epoch, std::memory_order_acquire);
+        }
+        completion.waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    size_t worker_count() const {
+        return workers.size();
+    }
+
+    SchedulingPolicy scheduling() const {
+        return scheduling_policy;
+    }
+
+    const OverflowPolicy& overflow() const {
+        return overflow_policy;
+    }
+
+    // Run time of every task so far, merged over workers (empty if
+    // PoolConfig::record_task_time is off)
+    LatencyHistogram task_latency() const {
+        return task_time.snapshot();
+    }
+
+    // Queue delay is empty if LaneConfig::record_queue_delay is off
+    LaneStats lane_stats(TaskPriority priority) const {
+        const size_t lane = lane_of(priority);
+        LaneStats stats;
+        for (const auto& worker : workers) {
+            stats.expired_dropped += worker->expired_dropped_count(lane);
+            stats.expired_deferred += worker->expired_deferred_count(lane);
+        }
+        stats.queue_delay = queue_delay[lane].snapshot();
+        return stats;
+    }
+
+    OverflowStats overflow_stats() const {
+        OverflowStats stats;
+        for_each_producer([&](const Producer& producer) {
+            stats.rejected += producer.rejected.load(std::memory_order_relaxed);
+            stats.blocked += producer.blocked.load(std::memory_order_relaxed);
+            stats.spilled += producer.spilled.load(std::memory_order_relaxed);
+            stats.dropped += producer.dropped.load(std::memory_order_relaxed);
+            stats.ran_inline += producer.ran_inline.load(std::memory_order_relaxed);
+        });
+        return stats;
+    }
+};
+
+// Tasks are stored inline: a dispatch that captures a callback pointer and a
+// MarketTick fits, and a bigger capture fails to compile instead of allocating
+using LockFreeThreadPool = BasicLockFreeThreadPool<InlineTask<128>>;
+
+// How an event travels inside a single dispatch task (a pinned
+// KeyedEventBroker shard). Small trivially copyable events (e.g. interned
+// MarketTick) are copied into the task by value: a memcpy, no allocation.
+// Anything else goes into a pooled EventEnvelope. Fan-out publishes copy the
+// event once into the Dispatch their tasks share instead.
+template<typename Event>
+constexpr bool kInlineEvent = std::is_trivially_copyable_v<Event> && sizeof(Event) <= kCacheLineSize;
+
+template<typename Event>
+auto make_event_payload(const Event& event) {
+    if constexpr (kInlineEvent<Event>) {
+        return event;
+    } else {
+        return EventEnvelope<Event>::make(event);
+    }
+}
+
+template<typename Event>
+const Event& payload_event(const Event& payload) {
+    return payload;
+}
+
+template<typename Event>
+const Event& payload_event(const EventEnvelope<Event>& payload) {
+    return *payload;
+}
+
+// Where a dispatched slice sits in its broker's publish order: every event
+// published gets the next sequence number (a slice's events are consecutive,
+// from sequence), and published is the latency_now() of its publish.
+// Subscribers run concurrently, so this is the only order they can rely on.
+struct PublishStamp {
+    uint64_t sequence;
+    uint64_t published;
+};
+
+// High-performance event broker using thread pool
+// Subscribers live in an immutable, contiguous RcuSnapshot (rcu_snapshot.h):
+// publish is one atomic load and a linear scan, subscribe/unsubscribe copy
+// the array and swap it in. Snapshots (and their shared_ptr control blocks)
+// come from Allocator; the default draws them from the per-thread arena.
+//
+// A publish shares one pooled Dispatch among all its tasks: the snapshot it
+// was issued from, the events and their PublishStamp. The references for every
+// task are taken at once (EventEnvelope::Shares), so a task costs one atomic
+// release, and the snapshot -- with the callback the task points into --
+// lives until the last task of that publish is gone.
+template<typename Event, typename Allocator = ArenaAllocator<char>>
+class HighPerfEventBroker {
+public:
+    using Callback = std::function<void(const Event&)>;
+    using BatchCallback = std::function<void(std::span<const Event>)>;
+    using StampedBatchCallback = std::function<void(std::span<const Event>, PublishStamp)>;
+    using SubscriptionId = uint64_t;
+
+private:
+    // Exactly one of the callbacks is set; the dispatches go to the pool
+    // lane of priority
+    struct Subscriber {
+        SubscriptionId id;
+        Callback callback;
+        BatchCallback batch_callback;
+        StampedBatchCallback stamped_callback;
+        TaskPriority priority;
+    };
+
+    using Snapshot = std::vector<Subscriber>;
+
+    template<typename Events>
+    struct Dispatch {
+        std::shared_ptr<const Snapshot> subscribers;
+        Events events;
+        PublishStamp stamp;
+    };
+
+    RcuSnapshot<Snapshot, Allocator> subscribers;
+    std::atomic<SubscriptionId> next_id{1};
+    std::atomic<uint64_t> next_sequence{0}; // Publish order, see PublishStamp
+    LockFreeThreadPool& pool;
+    ShardedCounter events_published;
+    ShardedCounter callbacks_executed; // Bumped by every worker: one slot each
+    ShardedCounter dispatches_rejected; // Refused by the pool's overflow policy
+    // Per dispatch, in ns: publish -> task start, callback run time, publish -> callback done
+    LatencyRecorder queue_delay;
+    LatencyRecorder callback_time;
+    LatencyRecorder end_to_end;
+
+    SubscriptionId add(Subscriber subscriber) {
+        subscriber.id = next_id.fetch_add(1, std::memory_order_relaxed);
+        subscribers.update([&subscriber](Snapshot& snapshot) {
+            snapshot.push_back(subscriber);
+            return true;
+        });
+        return subscriber.id;
+    }
+
+    // Runs one subscriber over a slice, whichever kind of callback it has,
+    // and records the dispatch's latencies on the worker's own histograms
+    void deliver(const Subscriber& sub, std::span<const Event> events, const PublishStamp& stamp) {
+        const uint64_t published = stamp.published;
+        const uint64_t started = latency_now();
+        if (sub.stamped_callback) {
+            sub.stamped_callback(events, stamp);
+        } else if (sub.batch_callback) {
+            sub.batch_callback(events);
+        } else {
+            for (const Event& event : events) {
+                sub.callback(event);
+            }
+        }
+        const uint64_t finished = latency_now();
+        queue_delay.record(started - published);
+        callback_time.record(finished - started);
+        end_to_end.record(finished - published);
+    }
+
+public:
+    explicit HighPerfEventBroker(LockFreeThreadPool& thread_pool) 
+        : pool(thread_pool) {}
+
+    // Lock-free subscribe; subscribers are dispatched in subscription order.
+    // A Critical subscriber (a risk check) is not delayed by a burst of
+    // Bulk ones (logging) queued in the same pool.
+    SubscriptionId subscribe(Callback callback, TaskPriority priority = TaskPriority::Normal) {
+        return add({0, std::move(callback), nullptr, nullptr, priority});
+    }
+
+    // Subscribe with a callback that receives a contiguous slice of events,
+    // so it can amortise per-call work or vectorise over the slice
+    SubscriptionId subscribe_batch(BatchCallback callback, TaskPriority priority = TaskPriority::Normal) {
+        return add({0, nullptr, std::move(callback), nullptr, priority});
+    }
+
+    // A batch subscriber that also gets the slice's PublishStamp, to put
+    // what concurrent dispatches hand it back into publish order (EventJournal)
+    SubscriptionId subscribe_stamped(StampedBatchCallback callback, TaskPriority priority = TaskPriority::Normal) {
+        return add({0, nullptr, nullptr, std::move(callback), priority});
+    }
+
+    // Returns false if id is not subscribed. Dispatches already issued for
+    // this subscriber still run, and so can one from a publish that loaded
+    // the subscriber list just before the swap; drain() after unsubscribing
+    // before freeing anything the callback uses.
+    bool unsubscribe(SubscriptionId id) {
+        return subscribers.update([id](Snapshot& snapshot) {
+            auto it = std::find_if(snapshot.begin(), snapshot.end(),
+                                   [id](const Subscriber& sub) { return sub.id == id; });
+            if (it == snapshot.end()) {
+                return false;
+            }
+            snapshot.erase(it);
+            return true;
+        });
+    }
+
+    // Lock-free publish with parallel dispatch
+    void publish(const Event& event) {
+        events_published.add(1);
+
+        auto snapshot = subscribers.load();
+        if (snapshot->empty()) {
+            return;
+        }
+        const uint32_t fan_out = static_cast<uint32_t>(snapshot->size());
+        const uint64_t sequence = next_sequence.fetch_add(1, std::memory_order_relaxed);
+        auto dispatch = EventEnvelope<Dispatch<Event>>::make(
+            Dispatch<Event>{std::move(snapshot), event, PublishStamp{sequence, latency_now()}});
+        typename EventEnvelope<Dispatch<Event>>::Shares shares(dispatch, fan_out);
+        for (const Subscriber& subscriber : *dispatch->subscribers) {
+            // Dispatch each callback to thread pool
+            if (!pool.submit(subscriber.priority, [d = shares.claim(), sub = &subscriber, this]() {
+                    deliver(*sub, std::span<const Event>(&d->events, 1), d->stamp);
+                    callbacks_executed.add(1);
+                })) {
+                dispatches_rejected.add(1);
+            }
+        }
+    }
+
+    // Publish a batch: the events are copied once into a pooled envelope and
+    // every subscriber gets the whole slice as a single pool task, i.e. one
+    // queue operation per subscriber per batch instead of per event
+    void publish_batch(std::span<const Event> events) {
+        if (events.empty()) {
+            return;
+        }
+        events_published.add(events.size());
+
+        auto snapshot = subscribers.load();
+        if (snapshot->empty()) {
+            return;
+        }
+        const uint32_t fan_out = static_cast<uint32_t>(snapshot->size());
+        const uint64_t sequence = next_sequence.fetch_add(events.size(), std::memory_order_relaxed);
+        auto dispatch = EventEnvelope<Dispatch<std::vector<Event>>>::make(Dispatch<std::vector<Event>>{
+            std::move(snapshot), std::vector<Event>(events.begin(), events.end()),
+            PublishStamp{sequence, latency_now()}});
+        typename EventEnvelope<Dispatch<std::vector<Event>>>::Shares shares(dispatch, fan_out);
+        for (const Subscriber& subscriber : *dispatch->subscribers) {
+            if (!pool.submit(subscriber.priority, [d = shares.claim(), sub = &subscriber, this]() {
+                    deliver(*sub, std::span<const Event>(d->events), d->stamp);
+                    callbacks_executed.add(d->events.size());
+                })) {
+                dispatches_rejected.add(1);
+            }
+        }
+    }
+
+    size_t subscriber_count() const {
+        return subscribers.load()->size();
+    }
+
+    // Wait until every dispatch made so far has run. The pool may be shared,
+    // so this waits for the whole pool rather than only this broker's tasks.
+    void drain() {
+        pool.drain();
+    }
+
+    uint64_t get_events_published() const {
+        return events_published.load();
+    }
+
+    uint64_t get_callbacks_executed() const {
+        return callbacks_executed.load();
+    }
+
+    uint64_t get_dispatches_rejected() const {
+        return dispatches_rejected.load();
+    }
+
+    // Merged on demand from the workers' histograms; one sample per dispatch
+    // (a batch dispatch counts once)
+    LatencyHistogram get_queue_delay() const { return queue_delay.snapshot(); }
+    LatencyHistogram get_callback_time() const { return callback_time.snapshot(); }
+    LatencyHistogram get_end_to_end() const { return end_to_end.snapshot(); }
+};
+
+// Keyed (topic-sharded) broker: subscribers register for one symbol and only
+// see that symbol's events, so fan-out cost follows the number of interested
+// subscribers instead of the total. Symbols are interned to SymbolIds; each
+// id hashes to one of kShards shards, and each shard publishes an immutable
+// id -> subscriber-snapshot table (an RcuSnapshot, like HighPerfEventBroker).
+//
+// With pin_symbols, every event of a shard goes to one fixed worker as a
+// single task that runs that symbol's subscribers in order, so per-symbol
+// ordering holds without locks (needs a RoundRobin pool: stealing would let
+// another worker run a later tick first; and a publishing thread that holds
+// a producer slot, see PoolConfig::producers).
+template<typename Event>
+class KeyedEventBroker {
+public:
+    using Callback = std::function<void(const Event&)>;
+
+private:
+    static constexpr size_t kShards = 64;
+
+    using Snapshot = std::vector<Callback>;
+    using Table = std::unordered_map<SymbolId, std::shared_ptr<const Snapshot>>;
+
+    struct alignas(64) Shard {
+        RcuSnapshot<Table> table;
+    };
+
+    // Shared by the tasks of one unpinned publish, as in HighPerfEventBroker
+    struct Dispatch {
+        std::shared_ptr<const Snapshot> callbacks;
+        Event event;
+    };
+
+    SymbolTable& symbols;
+    LockFreeThreadPool& pool;
+    const bool pinned;
+    std::vector<Shard> shards;
+    ShardedCounter events_published;
+    ShardedCounter callbacks_executed; // Bumped by every worker: one slot each
+    ShardedCounter dispatches_rejected; // Refused by the pool's overflow policy
+
+    static size_t shard_of(SymbolId id) {
+        return id % kShards;
+    }
+
+public:
+    KeyedEventBroker(SymbolTable& symbol_table, LockFreeThreadPool& thread_pool, bool pin_symbols = false)
+        : symbols(symbol_table), pool(thread_pool), pinned(pin_symbols), shards(kShards) {
+        if (pinned && pool.scheduling() != SchedulingPolicy::RoundRobin) {
+            throw std::runtime_error("KeyedEventBroker: pin_symbols needs a RoundRobin pool");
+        }
+        if (pinned && pool.overflow().mode != OverflowPolicy::Mode::Reject &&
+            pool.overflow().mode != OverflowPolicy::Mode::BlockSpin) {
+            throw std::runtime_error("KeyedEventBroker: pin_symbols needs a Reject or BlockSpin overflow policy");
+        }
+    }
+
+    // Lock-free subscribe (copy-on-write of one shard's table)
+    void subscribe(SymbolId key, Callback callback) {
+        shards[shard_of(key)].table.update([&](Table& table) {
+            auto& slot = table[key];
+            auto next_snapshot = slot ? std::make_shared<Snapshot>(*slot) : std::make_shared<Snapshot>();
+            next_snapshot->push_back(callback);
+            slot = std::move(next_snapshot);
+            return true;
+        });
+    }
+
+    void subscribe(std::string_view key, Callback callback) {
+        subscribe(symbols.intern(key), std::move(callback));
+    }
+
+    // One shard load and one hash lookup; symbols nobody listens to cost nothing more
+    void publish(SymbolId key, const Event& event) {
+        events_published.add(1);
+
+        const size_t shard_index = shard_of(key);
+        auto table = shards[shard_index].table.load();
+        auto it = table->find(key);
+        if (it == table->end()) {
+            return;
+        }
+        std::shared_ptr<const Snapshot> snapshot = it->second;
+
+        if (pinned) {
+            if (!pool.submit_to(shard_index, [snapshot, payload = make_event_payload(event), this]() {
+                    for (const Callback& callback : *snapshot) {
+                        callback(payload_event(payload));
+                    }
+                    callbacks_executed.add(snapshot->size());
+                })) {
+                dispatches_rejected.add(1);
+            }
+            return;
+        }
+        const uint32_t fan_out = static_cast<uint32_t>(snapshot->size());
+        auto dispatch = EventEnvelope<Dispatch>::make(Dispatch{std::move(snapshot), event});
+        typename EventEnvelope<Dispatch>::Shares shares(dispatch, fan_out);
+        for (const Callback& callback : *dispatch->callbacks) {
+            if (!pool.submit([d = shares.claim(), cb = &callback, this]() {
+                    (*cb)(d->event);
+                    callbacks_executed.add(1);
+                })) {
+                dispatches_rejected.add(1);
+            }
+        }
+    }
+
+    // Convenience overload: a symbol that was never interned has no subscribers
+    void publish(std::string_view key, const Event& event) {
+        SymbolId id;
+        if (symbols.find(key, id)) {
+            publish(id, event);
+        } else {
+            events_published.add(1);
+        }
+    }
+
+    void drain() {
+        pool.drain();
+    }
+
+    uint64_t get_events_published() const {
+        return events_published.load();
+    }
+
+    uint64_t get_callbacks_executed() const {
+        return callbacks_executed.load();
+    }
+
+    uint64_t get_dispatches_rejected() const {
+        return dispatches_rejected.load();
+    }
+};
+
+// Example application: Real-time trading system
+
+// Fixed-point price in 1/10000ths: exact for exchange prices, compared as integers
+using Price = int64_t;
+constexpr Price kPriceScale = 10000;
+
+constexpr Price to_price(double value) {
+    return static_cast<Price>(value * kPriceScale + (value < 0 ? -0.5 : 0.5));
+}
+
+// Hot-path event: interned symbol, no std::string, so copying it into a
+// dispatch task is a 24-byte memcpy
+struct MarketTick {
+    SymbolId symbol; // Interned in the TradingSystem's SymbolTable
+    int32_t volume;
+    Price price;
+    uint64_t timestamp;
+};
+static_assert(kInlineEvent<MarketTick>, "MarketTick must stay trivially copyable and fit a cache line");
+
+class TradingSystem {
+private:
+    SymbolTable symbols;
+    LockFreeThreadPool pool;
+    HighPerfEventBroker<MarketTick> market_broker;
+
+    ShardedCounter signals_generated;
+    ShardedCounter risks_checked;
+    ShardedCounter trades_logged;
+
+public:
+    TradingSystem(size_t threads = std::thread::hardware_concurrency()) 
+        : pool(threads), market_broker(pool) {
+        
+        // Subscribe strategy (batch-aware: scans the whole slice, then pays
+        // its fixed per-call cost once)
+        market_broker.subscribe_batch([this](std::span<const MarketTick> ticks) {
+            int signals = 0;
+            for (const MarketTick& tick : ticks) {
+                signals += tick.price > to_price(150.0) ? 1 : 0;
+            }
+            signals_generated.add(signals);
+            std::this_thread::sleep_for(std::chrono::microseconds(10));
+        });
+
+        // Subscribe risk engine: Critical, so it never queues behind logging
+        market_broker.subscribe([this](const MarketTick& tick) {
+            // Simulate risk check
+            if (tick.volume > 1000) {
+                risks_checked.add(1);
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(15));
+        }, TaskPriority::Critical);
+
+        // Subscribe logger
+        market_broker.subscribe([this](const MarketTick& tick) {
+            // Simulate logging
+            trades_logged.add(1);
+            std::this_thread::sleep_for(std::chrono::microseconds(5));
+        }, TaskPriority::Bulk);
+
+        std::cout << "[TradingSystem] Initialized with " 
+                  << pool.worker_count() << " workers\n";
+    }
+
+    // Subscribers capture this object, so let queued callbacks finish first
+    ~TradingSystem() {
+        market_broker.drain();
+    }
+
+    void wait_until_processed() {
+        market_broker.drain();
+    }
+
+    // Feed handlers intern each symbol once and stamp ticks with the id
+    SymbolId intern(std::string_view symbol) {
+        return symbols.intern(symbol);
+    }
+
+    void process_tick(const MarketTick& tick) {
+        market_broker.publish(tick);
+    }
+
+    void process_ticks(std::span<const MarketTick> ticks) {
+        market_broker.publish_batch(ticks);
+    }
+
+    void print_stats() {
+        std::cout << "\n=== Trading System Statistics ===\n";
+        std::cout << "Events published: " << market_broker.get_events_published() << "\n";
+        std::cout << "Callbacks executed: " << market_broker.get_callbacks_executed() << "\n";
+        std::cout << "Dispatches rejected: " << market_broker.get_dispatches_rejected() << "\n";
+        std::cout << "Queue delay:   " << market_broker.get_queue_delay().summary() << "\n";
+        std::cout << "Callback time: " << market_broker.get_callback_time().summary() << "\n";
+        std::cout << "End-to-end:    " << market_broker.get_end_to_end().summary() << "\n";
+        std::cout << "Pool task run: " << pool.task_latency().summary() << "\n";
+        for (TaskPriority priority : {TaskPriority::Critical, TaskPriority::Normal, TaskPriority::Bulk}) {
+            std::cout << "Lane delay, " << priority_name(priority) << ": "
+                      << pool.lane_stats(priority).queue_delay.summary() << "\n";
+        }
+        std::cout << "Signals generated: " << signals_generated.load() << "\n";
+        std::cout << "Risks checked: " << risks_checked.load() << "\n";
+        std::cout << "Trades logged: " << trades_logged.load() << "\n";
+    }
+};
+
+// Benchmark: queue delay under skewed callback cost
+// Every 16th task is slow. With round-robin submission all slow tasks land
+// on the same worker, and everything queued behind them waits.
+struct LatencyReport {
+    double p50_us;
+    double p99_us;
+    double max_us;
+};
+
+double percentile(std::vector<double>& samples, double p) {
+    size_t rank = static_cast<size_t>(p * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+void spin_for(std::chrono::nanoseconds duration) {
+    auto until = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < until) {
+    }
+}
+
+LatencyReport measure_skewed_latency(SchedulingPolicy policy, size_t threads, int tasks) {
+    LockFreeThreadPool pool(threads, policy);
+    std::vector<double> queue_delay_us(tasks, 0.0);
+
+    for (int i = 0; i < tasks; ++i) {
+        auto submitted = std::chrono::steady_clock::now();
+        auto cost = (i % 16 == 0) ? std::chrono::microseconds(200)
+                                  : std::chrono::microseconds(2);
+        while (!pool.submit([&queue_delay_us, i, submitted, cost] {
+            queue_delay_us[i] = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - submitted).count();
+            spin_for(cost);
+        })) {
+            std::this_thread::yield();
+        }
+    }
+
+    pool.drain();
+
+    LatencyReport report{};
+    report.p50_us = percentile(queue_delay_us, 0.50);
+    report.p99_us = percentile(queue_delay_us, 0.99);
+    report.max_us = *std::max_element(queue_delay_us.begin(), queue_delay_us.end());
+    return report;
+}
+
+void benchmark_scheduling() {
+    std::cout << "\n--- Benchmark: Round-Robin vs Work-Stealing (skewed callbacks) ---\n";
+    const size_t threads = 4;
+    const int tasks = 2000;
+
+    LatencyReport rr = measure_skewed_latency(SchedulingPolicy::RoundRobin, threads, tasks);
+    LatencyReport ws = measure_skewed_latency(SchedulingPolicy::WorkStealing, threads, tasks);
+
+    std::stringstream ss;
+    ss << "Queue delay over " << tasks << " tasks (1 in 16 costs 200us, rest 2us)\n";
+    ss << "  Round-robin:   p50 " << rr.p50_us << "us, p99 " << rr.p99_us
+       << "us, max " << rr.max_us << "us\n";
+    ss << "  Work-stealing: p50 " << ws.p50_us << "us, p99 " << ws.p99_us
+       << "us, max " << ws.max_us << "us\n";
+    std::cout << ss.str() << std::flush;
+}
+
+// ---------------------------------------------------------------------------
+// Pipeline mode: strategy -> risk -> logging
+//
+// TradingSystem fans every tick out to independent subscribers. On a real
+// desk the stages depend on each other: risk checks the order the strategy
+// proposes, and the trade log must record orders in arrival order. The two
+// engines below run the same stages under the same bound on in-flight
+// batches, so they can be compared on throughput and tail latency:
+//   - BrokerTradingPipeline: a HighPerfEventBroker per stage on one
+//     LockFreeThreadPool, with a re-sequencing buffer in front of the log
+//   - TbbTradingPipeline: tbb::parallel_pipeline with serial_in_order input
+//     and log stages and parallel strategy / risk stages (needs oneTBB)
+// ---------------------------------------------------------------------------
+
+struct PipelineTick {
+    MarketTick tick;
+    uint64_t seq;     // Arrival order, assigned by process_ticks()
+    uint64_t arrived; // latency_now() when the feed handed the tick over
+};
+
+struct ProposedOrder {
+    PipelineTick source;
+    int32_t quantity; // > 0 buy, < 0 sell, 0 no trade
+    bool approved;    // Set by the risk stage
+};
+
+constexpr auto kStrategyCost = std::chrono::microseconds(2);
+constexpr auto kRiskCost = std::chrono::microseconds(3);
+constexpr auto kLogCost = std::chrono::nanoseconds(500); // Per order, serial
+
+// Parallel stage: stateless, any tick on any thread
+inline ProposedOrder run_strategy(const PipelineTick& tick) {
+    spin_for(kStrategyCost);
+    int32_t quantity = 0;
+    if (tick.tick.price > to_price(185.0)) {
+        quantity = -tick.tick.volume / 10;
+    } else if (tick.tick.price < to_price(145.0)) {
+        quantity = tick.tick.volume / 10;
+    }
+    return ProposedOrder{tick, quantity, false};
+}
+
+// Parallel stage: stateless position-limit check
+inline void run_risk(ProposedOrder& order) {
+    spin_for(kRiskCost);
+    order.approved = order.quantity != 0 && std::abs(order.quantity) <= 120;
+}
+
+// The serial end of the pipeline. Called by one thread at a time, in seq
+// order; anything that arrives out of order is counted, not reordered.
+class TradeLog {
+private:
+    uint64_t next_seq = 0;
+    uint64_t ticks = 0;
+    uint64_t orders = 0;
+    uint64_t approved = 0;
+    uint64_t out_of_order = 0;
+    LatencyHistogram end_to_end; // Feed -> logged, per tick
+
+public:
+    void append(std::span<const ProposedOrder> batch) {
+        for (const ProposedOrder& order : batch) {
+            out_of_order += order.source.seq != next_seq ? 1 : 0;
+            next_seq = order.source.seq + 1;
+            if (order.quantity != 0) {
+                spin_for(kLogCost);
+                ++orders;
+                approved += order.approved ? 1 : 0;
+            }
+            end_to_end.record(latency_now() - order.source.arrived);
+        }
+        ticks += batch.size();
+    }
+
+    uint64_t tick_count() const { return ticks; }
+    uint64_t order_count() const { return orders; }
+    uint64_t approved_count() const { return approved; }
+    uint64_t out_of_order_count() const { return out_of_order; }
+    const LatencyHistogram& latency() const { return end_to_end; }
+};
+
+// Common front end: stamps ticks, bounds the batches in flight and tracks
+// what has been logged. process_ticks() must be called from one feed thread.
+class TradingPipeline {
+private:
+    const uint32_t max_in_flight;
+    uint64_t next_seq = 0;  // Feed thread only
+    uint64_t submitted = 0; // Feed thread only
+    alignas(64) std::atomic<uint32_t> in_flight{0};
+    alignas(64) std::atomic<uint64_t> logged{0};
+    TradeLog trade_log; // Only touched by the serial log stage, read after drain()
+
+protected:
+    explicit TradingPipeline(size_t max_batches_in_flight)
+        : max_in_flight(static_cast<uint32_t>(std::max<size_t>(max_batches_in_flight, 1))) {}
+
+    // Hand one batch to the engine; it must end up in log_batch() exactly once
+    virtual void submit(std::vector<PipelineTick>&& batch) = 0;
+
+    // The engine's serial, in-order stage
+    void log_batch(std::span<const ProposedOrder> orders) {
+        trade_log.append(orders);
+        in_flight.fetch_sub(1, std::memory_order_release);
+        in_flight.notify_one();
+        logged.fetch_add(orders.size(), std::memory_order_release);
+        logged.notify_all();
+    }
+
+public:
+    virtual ~TradingPipeline() = default;
+
+    virtual const char* name() const = 0;
+
+    // Blocks while max_batches_in_flight batches are between feed and log
+    void process_ticks(std::span<const MarketTick> ticks) {
+        if (ticks.empty()) {
+            return;
+        }
+        for (uint32_t n = in_flight.load(std::memory_order_acquire); n >= max_in_flight;
+             n = in_flight.load(std::memory_order_acquire)) {
+            in_flight.wait(n, std::memory_order_acquire);
+        }
+        in_flight.fetch_add(1, std::memory_order_relaxed);
+
+        std::vector<PipelineTick> batch;
+        batch.reserve(ticks.size());
+        const uint64_t now = latency_now();
+        for (const MarketTick& tick : ticks) {
+            batch.push_back(PipelineTick{tick, next_seq++, now});
+        }
+        submitted += ticks.size();
+        submit(std::move(batch));
+    }
+
+    // Wait until every tick handed to process_ticks() has been logged
+    void drain() {
+        for (uint64_t n = logged.load(std::memory_order_acquire); n < submitted;
+             n = logged.load(std::memory_order_acquire)) {
+            logged.wait(n, std::memory_order_acquire);
+        }
+    }
+
+    // Only meaningful after drain()
+    const TradeLog& log() const {
+        return trade_log;
+    }
+};
+
+class BrokerTradingPipeline : public TradingPipeline {
+private:
+    // Declared first, destroyed last: stage callbacks run on its workers
+    LockFreeThreadPool pool;
+    HighPerfEventBroker<PipelineTick> ticks;
+    HighPerfEventBroker<ProposedOrder> proposals;
+    HighPerfEventBroker<ProposedOrder> checked;
+
+    // Batches that finished risk ahead of an earlier one, keyed by first seq
+    std::mutex log_mutex;
+    std::map<uint64_t, std::vector<ProposedOrder>> waiting;
+    uint64_t next_seq = 0; // Guarded by log_mutex
+
+    // What serial_in_order does inside TBB: run the log stage for the
+    // batch that is next in line, then for every waiting one that follows
+    void resequence(std::span<const ProposedOrder> batch) {
+        std::lock_guard<std::mutex> lock(log_mutex);
+        if (batch.front().source.seq != next_seq) {
+            waiting.emplace(batch.front().source.seq, std::vector<ProposedOrder>(batch.begin(), batch.end()));
+            return;
+        }
+        next_seq += batch.size();
+        log_batch(batch);
+        for (auto it = waiting.begin(); it != waiting.end() && it->first == next_seq; it = waiting.erase(it)) {
+            next_seq += it->second.size();
+            log_batch(it->second);
+        }
+    }
+
+    void submit(std::vector<PipelineTick>&& batch) override {
+        ticks.publish_batch(batch);
+    }
+
+public:
+    // Every worker publishes into the next stage, so each is a producer
+    // too. Spill never refuses a task: a lost batch would stall the log.
+    BrokerTradingPipeline(size_t threads, size_t max_in_flight)
+        : TradingPipeline(max_in_flight),
+          pool(PoolConfig{threads, SchedulingPolicy::WorkStealing, threads + 1, IdlePolicy{},
+                          OverflowPolicy::with(OverflowPolicy::Mode::Spill), false}),
+          ticks(pool), proposals(pool), checked(pool) {
+        ticks.subscribe_batch([this](std::span<const PipelineTick> batch) {
+            std::vector<ProposedOrder> orders;
+            orders.reserve(batch.size());
+            for (const PipelineTick& tick : batch) {
+                orders.push_back(run_strategy(tick));
+            }
+            proposals.publish_batch(orders);
+        });
+        proposals.subscribe_batch([this](std::span<const ProposedOrder> batch) {
+            std::vector<ProposedOrder> orders(batch.begin(), batch.end());
+            for (ProposedOrder& order : orders) {
+                run_risk(order);
+            }
+            checked.publish_batch(orders);
+        });
+        checked.subscribe_batch([this](std::span<const ProposedOrder> batch) {
+            resequence(batch);
+        });
+    }
+
+    ~BrokerTradingPipeline() override {
+        drain();
+        pool.drain();
+    }
+
+    const char* name() const override {
+        return "HighPerfEventBroker";
+    }
+};
+
+#if HAS_TBB
+class TbbTradingPipeline : public TradingPipeline {
+private:
+    struct Batch {
+        std::vector<PipelineTick> ticks;
+        std::vector<ProposedOrder> orders;
+    };
+
+    tbb::concurrent_bounded_queue<Batch*> inbox; // nullptr stops the pipeline
+    tbb::task_arena arena;
+    std::thread driver;
+
+    void submit(std::vector<PipelineTick>&& batch) override {
+        inbox.push(new Batch{std::move(batch), {}});
+    }
+
+    // One token per batch; at most max_in_flight tokens exist at a time
+    void run(size_t max_in_flight) {
+        tbb::parallel_pipeline(max_in_flight,
+            tbb::make_filter<void, Batch*>(tbb::filter_mode::serial_in_order,
+                [this](tbb::flow_control& control) -> Batch* {
+                    Batch* batch = nullptr;
+                    inbox.pop(batch);
+                    if (!batch) {
+                        control.stop();
+                    }
+                    return batch;
+                }) &
+            tbb::make_filter<Batch*, Batch*>(tbb::filter_mode::parallel, [](Batch* batch) {
+                batch->orders.reserve(batch->ticks.size());
+                for (const PipelineTick& tick : batch->ticks) {
+                    batch->orders.push_back(run_strategy(tick));
+                }
+                return batch;
+            }) &
+            tbb::make_filter<Batch*, Batch*>(tbb::filter_mode::parallel, [](Batch* batch) {
+                for (ProposedOrder& order : batch->orders) {
+                    run_risk(order);
+                }
+                return batch;
+            }) &
+            tbb::make_filter<Batch*, void>(tbb::filter_mode::serial_in_order, [this](Batch* batch) {
+                std::unique_ptr<Batch> owned(batch);
+                log_batch(owned->orders);
+            }));
+    }
+
+public:
+    // threads bounds the arena, the driver thread included, to match the
+    // broker's pool (TBB itself never runs more threads than it has CPUs)
+    TbbTradingPipeline(size_t threads, size_t max_in_flight)
+        : TradingPipeline(max_in_flight),
+          arena(std::clamp(static_cast<int>(threads), 1, tbb::info::default_concurrency())) {
+        inbox.set_capacity(static_cast<std::ptrdiff_t>(std::max<size_t>(max_in_flight, 1)));
+        driver = std::thread([this, max_in_flight] {
+            arena.execute([this, max_in_flight] { run(std::max<size_t>(max_in_flight, 1)); });
+        });
+    }
+
+    ~TbbTradingPipeline() override {
+        drain();
+        inbox.push(nullptr);
+        driver.join();
+    }
+
+    const char* name() const override {
+        return "tbb::parallel_pipeline";
+    }
+};
+#endif
+
+enum class PipelineEngine {
+    Broker, // BrokerTradingPipeline
+    Tbb     // TbbTradingPipeline, only when built with oneTBB
+};
+
+constexpr bool pipeline_engine_available(PipelineEngine engine) {
+    return engine == PipelineEngine::Broker || HAS_TBB;
+}
+
+std::unique_ptr<TradingPipeline> make_trading_pipeline(PipelineEngine engine, size_t threads,
+                                                       size_t max_in_flight) {
+    switch (engine) {
+    case PipelineEngine::Broker:
+        return std::make_unique<BrokerTradingPipeline>(threads, max_in_flight);
+    case PipelineEngine::Tbb:
+#if HAS_TBB
+        return std::make_unique<TbbTradingPipeline>(threads, max_in_flight);
+#else
+        break;
+#endif
+    }
+    throw std::runtime_error("trading pipeline engine not built (configure with oneTBB and HYBRID_WITH_TBB=ON)");
+}
+
+struct PipelineRun {
+    double ticks_per_sec;
+    uint64_t orders;
+    uint64_t approved;
+    uint64_t out_of_order;
+    LatencyHistogram latency;
+};
+
+// Feeds ticks in batches, as a feed handler would per packet
+PipelineRun run_pipeline(PipelineEngine engine, size_t threads, size_t max_in_flight, int total_ticks,
+                         size_t batch_size) {
+    std::unique_ptr<TradingPipeline> pipeline = make_trading_pipeline(engine, threads, max_in_flight);
+    std::vector<MarketTick> batch;
+    batch.reserve(batch_size);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < total_ticks; ++i) {
+        batch.push_back(MarketTick{static_cast<SymbolId>(i % 4), 500 + (i * 37) % 1000,
+                                   to_price(140.0 + (i * 7) % 50), static_cast<uint64_t>(i)});
+        if (batch.size() == batch_size || i + 1 == total_ticks) {
+            pipeline->process_ticks(batch);
+            batch.clear();
+        }
+    }
+    pipeline->drain();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    const TradeLog& log = pipeline->log();
+    return PipelineRun{total_ticks / elapsed.count(), log.order_count(), log.approved_count(),
+                       log.out_of_order_count(), log.latency()};
+}
+
+const char* pipeline_engine_name(PipelineEngine engine) {
+    return engine == PipelineEngine::Broker ? "HighPerfEventBroker:    " : "tbb::parallel_pipeline: ";
+}
+
+void demo_pipeline_mode() {
+    const int total_ticks = 2000;
+    for (PipelineEngine engine : {PipelineEngine::Broker, PipelineEngine::Tbb}) {
+        if (!pipeline_engine_available(engine)) {
+            std::cout << "  " << pipeline_engine_name(engine) << "not built (needs oneTBB)\n";
+            continue;
+        }
+        PipelineRun run = run_pipeline(engine, 4, 8, total_ticks, 50);
+        std::stringstream ss;
+        ss << "  " << pipeline_engine_name(engine) << static_cast<long>(run.ticks_per_sec) << " ticks/s, "
+           << run.orders << " orders (" << run.approved << " approved), " << run.out_of_order
+           << " logged out of order\n"
+           << "    end-to-end: " << run.latency.summary() << "\n";
+        std::cout << ss.str() << std::flush;
+    }
+}
+
+// Run with: 10_hybrid_approach --bench-pipeline (or the bench_trading_pipeline target)
+int run_pipeline_benchmark() {
+    const size_t threads = 4;
+    const int total_ticks = 40000;
+    std::cout << "=== Trading pipeline: HighPerfEventBroker vs tbb::parallel_pipeline ===\n"
+              << "strategy " << kStrategyCost.count() << "us + risk " << kRiskCost.count()
+              << "us in parallel, log " << kLogCost.count() << "ns per order serial in order, " << threads
+              << " threads (" << Topology::get().describe() << ")\n";
+
+    bool consistent = true;
+    for (size_t batch_size : {1, 16, 64}) {
+        for (size_t max_in_flight : {4, 16}) {
+            uint64_t orders = 0;
+            for (PipelineEngine engine : {PipelineEngine::Broker, PipelineEngine::Tbb}) {
+                if (!pipeline_engine_available(engine)) {
+                    continue;
+                }
+                PipelineRun run = run_pipeline(engine, threads, max_in_flight, total_ticks, batch_size);
+                if (run.out_of_order != 0 || (orders != 0 && run.orders != orders)) {
+                    consistent = false;
+                }
+                orders = run.orders;
+
+                std::stringstream ss;
+                ss << "  batch " << batch_size << ", " << max_in_flight << " in flight, "
+                   << pipeline_engine_name(engine) << static_cast<long>(run.ticks_per_sec) << " ticks/s, "
+                   << run.latency.summary() << "\n";
+                std::cout << ss.str() << std::flush;
+            }
+        }
+    }
+    if (!HAS_TBB) {
+        std::cout << "  (tbb::parallel_pipeline not built: configure with oneTBB and HYBRID_WITH_TBB=ON)\n";
+    }
+    if (!consistent) {
+        std::cout << "ERROR: engines disagree or logged out of order\n";
+        return 1;
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Event journal: record every published event, replay it later
+//
+// EventJournal is a batch subscriber for audit. Each event becomes a
+// fixed-size record in an append-only file, mapped into memory, that rotates
+// to a new segment file once full. Subscriber callbacks run on pool workers,
+// so each worker stages records in a CachedSPSCQueue of its own, stamped
+// with the publish sequence and time of their dispatch (PublishStamp). One
+// background flusher drains the rings, merges them back into publish order
+// and copies records into the mapping. Workers never touch the file, a lock
+// or a shared counter.
+// JournalReplay maps a journal read-only and feeds it back through
+// publish_batch, either as fast as possible or with the recorded spacing.
+// The latter makes a load generator with the bursts of a real session.
+//
+// Segment file: a 64-byte JournalSegmentHeader, then record_count records.
+// ---------------------------------------------------------------------------
+
+template<typename Event>
+struct JournalRecord {
+    uint64_t sequence;  // Publish sequence: records are in this order, a gap is an event never recorded
+    uint64_t published; // latency_now() of the publish
+    Event event;
+};
+
+struct JournalSegmentHeader {
+    char magic[8];           // kJournalMagic
+    uint32_t record_size;    // sizeof(JournalRecord<Event>): rejects a journal of another type
+    uint32_t segment;        // Index within the journal
+    uint64_t first_sequence; // Of the segment's first record
+    uint64_t record_count;   // Written by the flusher after every drain pass
+    unsigned char reserved[32];
+};
+static_assert(sizeof(JournalSegmentHeader) == 64, "segment header is part of the file format");
+
+constexpr char kJournalMagic[8] = {'E', 'V', 'J', 'R', 'N', 'L', '0', '1'};
+
+// "segment-000042.journal"
+inline std::filesystem::path journal_segment_path(const std::filesystem::path& directory, uint32_t segment) {
+    std::string number = std::to_string(segment);
+    return directory / ("segment-" + std::string(6 - std::min<size_t>(number.size(), 6), '0') + number + ".journal");
+}
+
+// A whole file mapped into memory, read-write (create) or read-only (open)
+class MappedFile {
+private:
+    unsigned char* bytes = nullptr;
+    size_t length = 0;
+    int fd = -1;
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept
+        : bytes(std::exchange(other.bytes, nullptr)), length(std::exchange(other.length, 0)),
+          fd(std::exchange(other.fd, -1)) {}
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            bytes = std::exchange(other.bytes, nullptr);
+            length = std::exchange(other.length, 0);
+            fd = std::exchange(other.fd, -1);
+        }
+        return *this;
+    }
+
+    ~MappedFile() {
+        close();
+    }
+
+    unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool is_open() const { return bytes != nullptr; }
+
+#if HAS_MMAP
+    // New file of size bytes (zero-filled, sparse until written), mapped shared
+    static MappedFile create(const std::filesystem::path& path, size_t size) {
+        MappedFile file;
+        file.fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (file.fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path.string());
+        }
+        if (::ftruncate(file.fd, static_cast<off_t>(size)) != 0) {
+            throw std::system_error(errno, std::generic_category(), "ftruncate " + path.string());
+        }
+        file.map(path, size, PROT_READ | PROT_WRITE);
+        return file;
+    }
+
+    static MappedFile open_read_only(const std::filesystem::path& path) {
+        MappedFile file;
+        file.fd = ::open(path.c_str(), O_RDONLY);
+        if (file.fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path.string());
+        }
+        struct stat info {};
+        if (::fstat(file.fd, &info) != 0) {
+            throw std::system_error(errno, std::generic_category(), "fstat " + path.string());
+        }
+        file.map(path, static_cast<size_t>(info.st_size), PROT_READ);
+        return file;
+    }
+
+    // Write dirty pages back and shrink the file to its first keep bytes.
+    // Closed even when it throws.
+    void close_at(size_t keep) {
+        if (bytes) {
+            const int synced = ::msync(bytes, length, MS_SYNC);
+            const int sync_error = errno;
+            ::munmap(bytes, length);
+            bytes = nullptr;
+            if (synced != 0) {
+                close();
+                throw std::system_error(sync_error, std::generic_category(), "msync journal segment");
+            }
+            if (::ftruncate(fd, static_cast<off_t>(keep)) != 0) {
+                const int truncate_error = errno;
+                close();
+                throw std::system_error(truncate_error, std::generic_category(), "ftruncate journal segment");
+            }
+        }
+        close();
+    }
+
+    void close() {
+        if (bytes) {
+            ::munmap(bytes, length);
+            bytes = nullptr;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+        length = 0;
+    }
+
+private:
+    void map(const std::filesystem::path& path, size_t size, int protection) {
+        if (size == 0) {
+            throw std::runtime_error("empty file: " + path.string());
+        }
+        void* address = ::mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap " + path.string());
+        }
+        bytes = static_cast<unsigned char*>(address);
+        length = size;
+    }
+#else
+    static MappedFile create(const std::filesystem::path&, size_t) {
+        throw std::runtime_error("the event journal needs POSIX mmap");
+    }
+
+    static MappedFile open_read_only(const std::filesystem::path&) {
+        throw std::runtime_error("the event journal needs POSIX mmap");
+    }
+
+    void close_at(size_t) {}
+    void close() {}
+#endif
+};
+
+template<typename Event, size_t RingSize = 4096>
+class EventJournal {
+    static_assert(std::is_trivially_copyable_v<Event>, "journal records are raw copies of the event");
+
+public:
+    using Record = JournalRecord<Event>;
+
+    struct Stats {
+        uint64_t records;
+        uint32_t segments;
+        uint64_t bytes;           // Headers and records written so far
+        uint64_t producer_stalls; // Times a worker found its staging ring full and had to wait
+    };
+
+private:
+    // One per recording thread: that thread pushes, the flusher pops
+    struct Staging {
+        CachedSPSCQueue<Record, RingSize> ring;
+        alignas(64) std::atomic<uint64_t> staged{0}; // Written by the recording thread only
+        std::atomic<uint64_t> stalls{0};
+        uint64_t thread = 0; // this_thread_token() of the recording thread
+        // Flusher only: drained records still waiting for an earlier sequence
+        std::vector<Record> backlog;
+        size_t backlog_head = 0;
+    };
+
+    const std::filesystem::path directory;
+    const size_t records_per_segment;
+    const uint64_t journal_id;
+
+    mutable std::mutex staging_mutex; // Guards stagings (registration only)
+    std::vector<std::unique_ptr<Staging>> stagings;
+    std::atomic<size_t> staging_count{0};
+
+    alignas(64) std::atomic<uint64_t> written{0}; // Records copied into a segment
+    std::atomic<uint32_t> segment_count{0};
+    CompletionSignal flushed;
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> failed{false};
+    std::exception_ptr failure; // Set by the flusher before failed; read only after seeing failed
+    bool closed = false;        // close() was called
+
+    // Flusher thread only
+    MappedFile segment;
+    uint32_t segment_index = 0;
+    uint64_t segment_records = 0;
+    uint64_t next_sequence = 0; // The publish sequence the journal waits for next
+
+    std::thread flusher; // Started last: uses every member above
+
+    // Per-thread cache first (thread_slot_cache.h), as in LatencyRecorder
+    Staging& local_staging() {
+        return ThreadSlotCache<Staging>::get(journal_id, [this]() -> Staging& {
+            const uint64_t thread = this_thread_token();
+            std::lock_guard<std::mutex> lock(staging_mutex);
+            for (const auto& staging : stagings) {
+                if (staging->thread == thread) {
+                    return *staging;
+                }
+            }
+            stagings.push_back(std::make_unique<Staging>());
+            stagings.back()->thread = thread;
+            staging_count.store(stagings.size(), std::memory_order_release);
+            return *stagings.back();
+        });
+    }
+
+    JournalSegmentHeader& header() {
+        return *reinterpret_cast<JournalSegmentHeader*>(segment.data());
+    }
+
+    void open_segment() {
+        segment = MappedFile::create(journal_segment_path(directory, segment_index),
+                                     sizeof(JournalSegmentHeader) + records_per_segment * sizeof(Record));
+        JournalSegmentHeader& h = header();
+        std::memcpy(h.magic, kJournalMagic, sizeof(kJournalMagic));
+        h.record_size = sizeof(Record);
+        h.segment = segment_index;
+        h.first_sequence = next_sequence;
+        h.record_count = 0;
+        segment_records = 0;
+        segment_count.store(segment_index + 1, std::memory_order_relaxed);
+    }
+
+    void close_segment() {
+        segment.close_at(sizeof(JournalSegmentHeader) + segment_records * sizeof(Record));
+    }
+
+    void append(const Record* records, size_t count) {
+        while (count > 0) {
+            if (segment_records == records_per_segment) {
+                close_segment();
+                ++segment_index;
+                open_segment();
+            }
+            const size_t n = std::min<size_t>(count, records_per_segment - segment_records);
+            unsigned char* out = segment.data() + sizeof(JournalSegmentHeader) + segment_records * sizeof(Record);
+            if (segment_records == 0) {
+                header().first_sequence = records[0].sequence;
+            }
+            std::memcpy(out, records, n * sizeof(Record));
+            segment_records += n;
+            header().record_count = segment_records;
+            records += n;
+            count -= n;
+        }
+    }
+
+    // Segment I/O errors end the flusher; flush() and close() report them
+    void flusher_main() {
+        try {
+            drain_stagings();
+            close_segment();
+        } catch (...) {
+            failure = std::current_exception();
+            failed.store(true, std::memory_order_seq_cst);
+            flushed.notify();
+        }
+    }
+
+    // Until stopping, and everything staged before it was set is written.
+    // A ring holds its thread's records in publish order, so the journal is a
+    // merge of the rings by sequence: each pass drains every ring into its
+    // backlog, then repeatedly writes the run at the lowest backlog head that
+    // continues next_sequence. A record whose predecessor is still missing
+    // waits -- the worker holding it may just be descheduled -- until a
+    // flush() or close() writes everything out.
+    void drain_stagings() {
+        const auto by_sequence = [](const Record& a, const Record& b) { return a.sequence < b.sequence; };
+        std::vector<Staging*> sources;
+        std::vector<Record> chunk(256);
+        uint32_t idle_rounds = 0;
+        while (true) {
+            // Observe stopping before the pass: a pass that starts after it
+            // was set sees everything the recording threads pushed
+            const bool stop = stopping.load(std::memory_order_acquire);
+            if (sources.size() != staging_count.load(std::memory_order_acquire)) {
+                std::lock_guard<std::mutex> lock(staging_mutex);
+                sources.clear();
+                for (const auto& staging : stagings) {
+                    sources.push_back(staging.get());
+                }
+            }
+            const bool force = stop || flushed.waiters.load(std::memory_order_acquire) > 0;
+
+            for (Staging* staging : sources) {
+                auto& backlog = staging->backlog;
+                if (staging->backlog_head > 0 && staging->backlog_head * 2 >= backlog.size()) {
+                    backlog.erase(backlog.begin(), backlog.begin() + static_cast<std::ptrdiff_t>(staging->backlog_head));
+                    staging->backlog_head = 0;
+                }
+                const size_t from = backlog.size();
+                size_t n;
+                while ((n = staging->ring.try_dequeue_bulk(chunk.data(), chunk.size())) > 0) {
+                    backlog.insert(backlog.end(), chunk.begin(), chunk.begin() + static_cast<std::ptrdiff_t>(n));
+                }
+                // Out of order only if the thread recorded a dispatch it stole
+                const auto first = backlog.begin() + static_cast<std::ptrdiff_t>(staging->backlog_head);
+                const auto middle = backlog.begin() + static_cast<std::ptrdiff_t>(from);
+                if (!std::is_sorted(middle, backlog.end(), by_sequence)) {
+                    std::sort(middle, backlog.end(), by_sequence);
+                }
+                if (first != middle && middle != backlog.end() && by_sequence(*middle, *(middle - 1))) {
+                    std::inplace_merge(first, middle, backlog.end(), by_sequence);
+                }
+            }
+
+            size_t moved = 0;
+            while (true) {
+                // The lowest head, and the next one (where a forced run ends)
+                Staging* lowest = nullptr;
+                uint64_t next_lowest = UINT64_MAX;
+                for (Staging* staging : sources) {
+                    if (staging->backlog_head == staging->backlog.size()) {
+                        continue;
+                    }
+                    const uint64_t head = staging->backlog[staging->backlog_head].sequence;
+                    if (lowest == nullptr || head < lowest->backlog[lowest->backlog_head].sequence) {
+                        if (lowest != nullptr) {
+                            next_lowest = lowest->backlog[lowest->backlog_head].sequence;
+                        }
+                        lowest = staging;
+                    } else {
+                        next_lowest = std::min(next_lowest, head);
+                    }
+                }
+                if (lowest == nullptr) {
+                    break;
+                }
+                const Record* run = lowest->backlog.data() + lowest->backlog_head;
+                const size_t available = lowest->backlog.size() - lowest->backlog_head;
+                size_t length = 0;
+                while (length < available &&
+                       (run[length].sequence <= next_sequence || (force && run[length].sequence < next_lowest))) {
+                    // Below next_sequence only if it arrived after a flush gave up on it
+                    next_sequence = std::max(next_sequence, run[length].sequence + 1);
+                    ++length;
+                }
+                if (length == 0) {
+                    break;
+                }
+                append(run, length);
+                lowest->backlog_head += length;
+                moved += length;
+            }
+            if (moved > 0) {
+                written.fetch_add(moved, std::memory_order_seq_cst);
+                flushed.notify();
+                idle_rounds = 0;
+                continue;
+            }
+            if (stop) {
+                return;
+            }
+            // Nothing staged: back off from spinning to short sleeps
+            if (++idle_rounds < 64) {
+                cpu_relax();
+            } else if (idle_rounds < 128) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    }
+
+public:
+    // Starts a new journal in directory, which must not hold one already
+    explicit EventJournal(std::filesystem::path journal_directory, size_t segment_bytes = size_t{64} << 20)
+        : directory(std::move(journal_directory)),
+          records_per_segment(std::max<size_t>((segment_bytes - sizeof(JournalSegmentHeader)) / sizeof(Record), 1)),
+          journal_id(next_slot_owner_id()) {
+        std::filesystem::create_directories(directory);
+        if (std::filesystem::exists(journal_segment_path(directory, 0))) {
+            throw std::runtime_error("a journal already exists in " + directory.string());
+        }
+        open_segment();
+        flusher = std::thread([this] { flusher_main(); });
+    }
+
+    // Like close() if that was not called, but a write error is only
+    // logged: never throws
+    ~EventJournal() {
+        if (closed) {
+            return;
+        }
+        try {
+            close();
+        } catch (const std::exception& error) {
+            std::cerr << "EventJournal " << directory.string() << ": " << error.what() << "\n";
+        }
+    }
+
+    EventJournal(const EventJournal&) = delete;
+    EventJournal& operator=(const EventJournal&) = delete;
+
+    // Safe from any number of threads, until close(); waits (and counts a
+    // stall) while the calling thread's ring is full. Never throws: once the
+    // journal has failed, records are dropped and flush()/close() report why.
+    // stamp places the events in publish order (see PublishStamp), which is
+    // the order they are journaled in.
+    void record(std::span<const Event> events, PublishStamp stamp) {
+        Staging& staging = local_staging();
+        uint64_t sequence = stamp.sequence;
+        Record chunk[64];
+        while (!events.empty()) {
+            const size_t n = std::min(events.size(), std::size(chunk));
+            for (size_t i = 0; i < n; ++i) {
+                chunk[i] = Record{sequence++, stamp.published, events[i]};
+            }
+            size_t pushed = staging.ring.try_enqueue_bulk(chunk, n);
+            while (pushed < n) {
+                if (failed.load(std::memory_order_acquire)) {
+                    return;
+                }
+                staging.stalls.store(staging.stalls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                std::this_thread::yield();
+                pushed += staging.ring.try_enqueue_bulk(chunk + pushed, n - pushed);
+            }
+            staging.staged.store(staging.staged.load(std::memory_order_relaxed) + n, std::memory_order_release);
+            events = events.subspan(n);
+        }
+    }
+
+    void record(const Event& event, PublishStamp stamp) {
+        record(std::span<const Event>(&event, 1), stamp);
+    }
+
+    // Block until every record() that returned before this call is in the
+    // mapped segment (the kernel writes it back; close() also msyncs).
+    // Records still waiting for an earlier sequence are written too, so
+    // flush once publishing has drained to keep the journal in publish order.
+    // Until then, the records after a dispatch that never reaches the
+    // journal (one the pool's overflow policy rejected or dropped) stay in
+    // memory: journal from a pool that spills or blocks instead.
+    // Throws the error that stopped the journal, if one did.
+    void flush() {
+        uint64_t target = 0;
+        {
+            std::lock_guard<std::mutex> lock(staging_mutex);
+            for (const auto& staging : stagings) {
+                target += staging->staged.load(std::memory_order_acquire);
+            }
+        }
+        flushed.waiters.fetch_add(1, std::memory_order_seq_cst);
+        while (true) {
+            uint32_t epoch = flushed.epoch.load(std::memory_order_acquire);
+            if (written.load(std::memory_order_seq_cst) >= target || failed.load(std::memory_order_seq_cst)) {
+                break;
+            }
+            flushed.epoch.wait(epoch, std::memory_order_acquire);
+        }
+        flushed.waiters.fetch_sub(1, std::memory_order_relaxed);
+        if (failed.load(std::memory_order_acquire)) {
+            std::rethrow_exception(failure);
+        }
+    }
+
+    // Writes out everything recorded, trims the last segment and stops the
+    // flusher. Throws what went wrong writing the journal, if anything did.
+    // Call once no record() is running; later calls only report again.
+    void close() {
+        closed = true;
+        if (flusher.joinable()) {
+            stopping.store(true, std::memory_order_release);
+            flusher.join();
+        }
+        if (failed.load(std::memory_order_acquire)) {
+            std::rethrow_exception(failure);
+        }
+    }
+
+    Stats stats() const {
+        const uint64_t records = written.load(std::memory_order_acquire);
+        const uint32_t segments = segment_count.load(std::memory_order_relaxed);
+        uint64_t stalls = 0;
+        {
+            std::lock_guard<std::mutex> lock(staging_mutex);
+            for (const auto& staging : stagings) {
+                stalls += staging->stalls.load(std::memory_order_relaxed);
+            }
+        }
+        return Stats{records, segments, segments * sizeof(JournalSegmentHeader) + records * sizeof(Record), stalls};
+    }
+};
+
+enum class ReplayPacing {
+    AsFastAsPossible, // Back-to-back batches of batch_size
+    Recorded          // Each record published when its original publish time's offset (scaled by speed) comes up
+};
+
+struct ReplayStats {
+    uint64_t events = 0;
+    uint64_t batches = 0;
+    double seconds = 0.0;
+    double recorded_seconds = 0.0; // Time spanned by the recorded timestamps
+};
+
+template<typename Event>
+class JournalReplay {
+public:
+    using Record = JournalRecord<Event>;
+
+private:
+    struct Segment {
+        MappedFile file;
+        uint64_t records;
+
+        Record record(uint64_t i) const {
+            Record r;
+            std::memcpy(&r, file.data() + sizeof(JournalSegmentHeader) + i * sizeof(Record), sizeof(Record));
+            return r;
+        }
+    };
+
+    std::vector<Segment> segments;
+    uint64_t total = 0;
+
+public:
+    // Maps every segment of the journal in directory
+    explicit JournalReplay(const std::filesystem::path& directory) {
+        for (uint32_t index = 0; std::filesystem::exists(journal_segment_path(directory, index)); ++index) {
+            const std::filesystem::path path = journal_segment_path(directory, index);
+            MappedFile file = MappedFile::open_read_only(path);
+            JournalSegmentHeader header;
+            if (file.size() < sizeof(header)) {
+                throw std::runtime_error("truncated journal segment: " + path.string());
+            }
+            std::memcpy(&header, file.data(), sizeof(header));
+            if (std::memcmp(header.magic, kJournalMagic, sizeof(kJournalMagic)) != 0 || header.segment != index) {
+                throw std::runtime_error("not a journal segment: " + path.string());
+            }
+            if (header.record_size != sizeof(Record)) {
+                throw std::runtime_error("journal records have another event type: " + path.string());
+            }
+            const uint64_t fits = (file.size() - sizeof(header)) / sizeof(Record);
+            const uint64_t records = std::min(header.record_count, fits);
+            total += records;
+            segments.push_back(Segment{std::move(file), records});
+        }
+        if (segments.empty()) {
+            throw std::runtime_error("no journal in " + directory.string());
+        }
+    }
+
+    uint64_t size() const {
+        return total;
+    }
+
+    // Calls visit(record) for every record, in journal order
+    template<typename Visit>
+    void for_each(Visit&& visit) const {
+        for (const Segment& segment : segments) {
+            for (uint64_t i = 0; i < segment.records; ++i) {
+                visit(segment.record(i));
+            }
+        }
+    }
+
+    // Publishes the journal through broker.publish_batch(), up to
+    // batch_size events at a time. With Recorded pacing a batch only holds
+    // records that are already due, so recorded bursts stay bursts; speed
+    // 2.0 replays twice as fast as recorded.
+    template<typename Broker>
+    ReplayStats replay(Broker& broker, size_t batch_size, ReplayPacing pacing = ReplayPacing::AsFastAsPossible,
+                       double speed = 1.0) const {
+        batch_size = std::max<size_t>(batch_size, 1);
+        std::vector<Event> batch;
+        batch.reserve(batch_size);
+        ReplayStats stats;
+        uint64_t first_published = 0;
+        uint64_t last_published = 0;
+        bool first = true;
+        const uint64_t start = latency_now();
+
+        auto publish = [&] {
+            broker.publish_batch(std::span<const Event>(batch));
+            stats.events += batch.size();
+            ++stats.batches;
+            batch.clear();
+        };
+
+        for_each([&](const Record& record) {
+            if (first) {
+                first_published = record.published;
+                first = false;
+            }
+            last_published = std::max(last_published, record.published);
+            if (pacing == ReplayPacing::Recorded) {
+                const uint64_t offset = record.published > first_published ? record.published - first_published : 0;
+                const uint64_t due = start + static_cast<uint64_t>(static_cast<double>(offset) / speed);
+                if (latency_now() < due) {
+                    // Not due yet: send what is, then wait for it
+                    if (!batch.empty()) {
+                        publish();
+                    }
+                    while (true) {
+                        const uint64_t now = latency_now();
+                        if (now >= due) {
+                            break;
+                        }
+                        if (due - now > 200000) {
+                            std::this_thread::sleep_for(std::chrono::nanoseconds(due - now - 100000));
+                        } else {
+                            cpu_relax();
+                        }
+                    }
+                }
+            }
+            batch.push_back(record.event);
+            if (batch.size() == batch_size) {
+                publish();
+            }
+        });
+        if (!batch.empty()) {
+            publish();
+        }
+        stats.seconds = static_cast<double>(latency_now() - start) / 1e9;
+        stats.recorded_seconds = static_cast<double>(last_published - first_published) / 1e9;
+        return stats;
+    }
+};
+
+// Fresh directory under the system temp dir, removed again on destruction
+class ScratchDirectory {
+private:
+    std::filesystem::path root;
+
+public:
+    explicit ScratchDirectory(const std::string& prefix)
+        : root(std::filesystem::temp_directory_path() / (prefix + "-" + std::to_string(latency_now()))) {
+        std::filesystem::create_directories(root);
+    }
+
+    ~ScratchDirectory() {
+        std::error_code ignored;
+        std::filesystem::remove_all(root, ignored);
+    }
+
+    ScratchDirectory(const ScratchDirectory&) = delete;
+    ScratchDirectory& operator=(const ScratchDirectory&) = delete;
+
+    const std::filesystem::path& path() const { return root; }
+};
+
+struct JournalRun {
+    double record_ticks_per_sec;
+    EventJournal<MarketTick>::Stats journal;
+    uint64_t volume; // Sum of all recorded volumes, to check the replay against
+};
+
+// Publishes total_ticks through a HighPerfEventBroker whose only subscriber
+// is an EventJournal, in batches as a feed handler would, pausing every
+// burst ticks so the recording has some pacing to reproduce
+JournalRun record_session(const std::filesystem::path& directory, size_t threads, int total_ticks,
+                          size_t batch_size, int burst, size_t segment_bytes) {
+    PoolConfig config{threads, SchedulingPolicy::RoundRobin, 1};
+    config.overflow = OverflowPolicy::with(OverflowPolicy::Mode::Spill);
+    config.log_creation = false;
+    LockFreeThreadPool pool(config);
+    EventJournal<MarketTick> journal(directory, segment_bytes);
+    HighPerfEventBroker<MarketTick> broker(pool);
+    broker.subscribe_stamped([&journal](std::span<const MarketTick> ticks, PublishStamp stamp) {
+        journal.record(ticks, stamp);
+    });
+
+    uint64_t volume = 0;
+    std::vector<MarketTick> batch;
+    batch.reserve(batch_size);
+    const uint64_t start = latency_now();
+    for (int i = 0; i < total_ticks; ++i) {
+        batch.push_back(MarketTick{static_cast<SymbolId>(i % 4), 500 + (i * 37) % 1000,
+                                   to_price(140.0 + (i * 7) % 50), static_cast<uint64_t>(i)});
+        volume += static_cast<uint64_t>(batch.back().volume);
+        if (batch.size() == batch_size || i + 1 == total_ticks) {
+            broker.publish_batch(batch);
+            batch.clear();
+        }
+        if (burst > 0 && (i + 1) % burst == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    broker.drain();
+    journal.flush();
+    const double seconds = static_cast<double>(latency_now() - start) / 1e9;
+    journal.close();
+    return JournalRun{total_ticks / seconds, journal.stats(), volume};
+}
+
+// The journal holds every tick record_session() published, in publish order
+// (record_session numbers its ticks 0, 1, ... in timestamp)
+bool journal_in_publish_order(const JournalReplay<MarketTick>& journal, uint64_t ticks) {
+    uint64_t expected = 0;
+    bool ordered = true;
+    journal.for_each([&](const JournalRecord<MarketTick>& record) {
+        ordered = ordered && record.sequence == expected && record.event.timestamp == expected;
+        ++expected;
+    });
+    return ordered && expected == ticks;
+}
+
+struct ReplayCheck {
+    ReplayStats stats;
+    double seconds; // Replay until the last subscriber returned
+    uint64_t delivered;
+    uint64_t volume;
+};
+
+ReplayCheck replay_session(const JournalReplay<MarketTick>& journal, size_t threads, size_t subscribers,
+                           size_t batch_size, ReplayPacing pacing) {
+    PoolConfig config{threads, SchedulingPolicy::RoundRobin, 1};
+    config.overflow = OverflowPolicy::with(OverflowPolicy::Mode::Spill);
+    config.log_creation = false;
+    LockFreeThreadPool pool(config);
+    HighPerfEventBroker<MarketTick> broker(pool);
+    ShardedCounter delivered;
+    std::atomic<uint64_t> volume{0};
+    for (size_t s = 0; s < subscribers; ++s) {
+        broker.subscribe_batch([&, s](std::span<const MarketTick> ticks) {
+            delivered.add(ticks.size());
+            if (s == 0) {
+                uint64_t sum = 0;
+                for (const MarketTick& tick : ticks) {
+                    sum += static_cast<uint64_t>(tick.volume);
+                }
+                volume.fetch_add(sum, std::memory_order_relaxed);
+            }
+        });
+    }
+    const uint64_t start = latency_now();
+    ReplayStats stats = journal.replay(broker, batch_size, pacing);
+    broker.drain();
+    const double seconds = static_cast<double>(latency_now() - start) / 1e9;
+    return ReplayCheck{stats, seconds, delivered.load(), volume.load()};
+}
+
+void demo_event_journal() {
+    if (!HAS_MMAP) {
+        std::cout << "  (needs POSIX mmap)\n";
+        return;
+    }
+    ScratchDirectory directory("hybrid-journal");
+    // Small segments so the demo rotates a few times
+    JournalRun run = record_session(directory.path(), 4, 5000, 50, 1000, 64 * 1024);
+    JournalReplay<MarketTick> journal(directory.path());
+    const bool ordered = journal_in_publish_order(journal, 5000);
+    ReplayCheck fast = replay_session(journal, 4, 2, 64, ReplayPacing::AsFastAsPossible);
+    ReplayCheck paced = replay_session(journal, 4, 2, 64, ReplayPacing::Recorded);
+
+    std::stringstream ss;
+    ss << "  Recorded " << run.journal.records << " ticks into " << run.journal.segments << " segments ("
+       << run.journal.bytes / 1024 << " KB, " << run.journal.producer_stalls << " staging stalls)"
+       << (ordered ? ", in publish order" : ", OUT OF PUBLISH ORDER") << "\n"
+       << "  Replay, full speed: " << fast.stats.events << " ticks in " << fast.stats.batches << " batches, "
+       << static_cast<long>(fast.stats.events / std::max(fast.seconds, 1e-9)) << " ticks/s"
+       << (fast.volume == run.volume ? ", volumes match" : ", VOLUME MISMATCH") << "\n"
+       << "  Replay, recorded pacing: " << paced.stats.seconds * 1000 << " ms for a "
+       << paced.stats.recorded_seconds * 1000 << " ms recording, " << paced.stats.batches << " batches"
+       << (paced.volume == run.volume ? ", volumes match" : ", VOLUME MISMATCH") << "\n";
+    std::cout << ss.str() << std::flush;
+}
+
+// Run with: 10_hybrid_approach --bench-journal (or the bench_journal target)
+int run_journal_benchmark() {
+    if (!HAS_MMAP) {
+        std::cout << "The event journal needs POSIX mmap\n";
+        return 1;
+    }
+    const int total_ticks = 1000000;
+    const size_t threads = 4;
+    std::cout << "=== Event journal: mmap'd segments, per-thread staging rings ===\n"
+              << total_ticks << " ticks, " << sizeof(JournalRecord<MarketTick>) << "-byte records, " << threads
+              << " pool workers (" << Topology::get().describe() << ")\n";
+
+    bool correct = true;
+    for (size_t batch_size : {1, 64}) {
+        ScratchDirectory directory("hybrid-journal-bench");
+        JournalRun run = record_session(directory.path(), threads, total_ticks, batch_size, 0, size_t{16} << 20);
+        JournalReplay<MarketTick> journal(directory.path());
+        ReplayCheck replay = replay_session(journal, threads, 4, 64, ReplayPacing::AsFastAsPossible);
+        correct = correct && run.journal.records == static_cast<uint64_t>(total_ticks) &&
+                  journal_in_publish_order(journal, static_cast<uint64_t>(total_ticks)) &&
+                  replay.stats.events == journal.size() && replay.volume == run.volume &&
+                  replay.delivered == 4 * journal.size();
+
+        const double record_mb = run.record_ticks_per_sec * sizeof(JournalRecord<MarketTick>) / 1e6;
+        std::stringstream ss;
+        ss << "  publish batch " << batch_size << ": record " << static_cast<long>(run.record_ticks_per_sec)
+           << " ticks/s (" << static_cast<long>(record_mb) << " MB/s, " << run.journal.segments << " segments, "
+           << run.journal.producer_stalls << " stalls), replay into 4 subscribers "
+           << static_cast<long>(replay.stats.events / std::max(replay.seconds, 1e-9)) << " ticks/s\n";
+        std::cout << ss.str() << std::flush;
+    }
+    if (!correct) {
+        std::cout << "ERROR: the replay does not match the recording\n";
+        return 1;
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Priority lanes: risk checks vs a logging burst
+//
+// One producer submits rounds of `burst` bulk logging tasks followed by one
+// risk check, then paces itself to the next round. With one FIFO (every task
+// in the Normal lane) a risk check waits for the whole burst ahead of it, so
+// its delay grows with the burst. In the Critical lane it only waits for a
+// worker to finish its current task: the lane's tail should stay flat while
+// the bulk lane absorbs the load. Every number is read from the pool's own
+// per-lane queue-delay histograms (lane_stats()); in the FIFO run the one
+// lane's histogram is also the risk checks', since a FIFO delays every task
+// alike whatever it is.
+// ---------------------------------------------------------------------------
+
+struct PriorityScenario {
+    const char* name;
+    bool lanes;             // False: risk checks share the Normal lane with the bulk tasks
+    LanePolicy order;
+    uint64_t bulk_deadline; // ns after submit; 0 for none
+    ExpiryAction bulk_expiry;
+};
+
+struct PriorityRun {
+    LaneStats risk;
+    LaneStats bulk;
+};
+
+constexpr uint64_t kRiskCheckNs = 1000;
+constexpr uint64_t kBulkTaskNs = 2000;
+constexpr uint64_t kPriorityRoundNs = 100000; // One risk check per 100 us
+
+PriorityRun run_priority_scenario(const PriorityScenario& scenario, size_t threads, size_t burst, int rounds) {
+    // Spill: a burst bigger than the inboxes parks in the overflow queue
+    // (served after every lane) instead of blocking the producer
+    PoolConfig config{threads, SchedulingPolicy::RoundRobin, 1, IdlePolicy{},
+                      OverflowPolicy::with(OverflowPolicy::Mode::Spill)};
+    config.record_task_time = false;
+    config.log_creation = false;
+    config.lanes.order = scenario.order;
+    config.lanes.on_expiry[lane_of(TaskPriority::Bulk)] = scenario.bulk_expiry;
+    const TaskPriority risk = scenario.lanes ? TaskPriority::Critical : TaskPriority::Normal;
+    const TaskPriority bulk = scenario.lanes ? TaskPriority::Bulk : TaskPriority::Normal;
+
+    LockFreeThreadPool pool(config);
+    uint64_t next_round = latency_now();
+    for (int round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < burst; ++i) {
+            const uint64_t deadline = scenario.bulk_deadline ? latency_now() + scenario.bulk_deadline : 0;
+            pool.submit(bulk, [] { busy_work(kBulkTaskNs); }, deadline);
+        }
+        pool.submit(risk, [] { busy_work(kRiskCheckNs); });
+        next_round += kPriorityRoundNs;
+        while (latency_now() < next_round) {
+            cpu_relax();
+        }
+    }
+    pool.drain();
+    return PriorityRun{pool.lane_stats(risk), pool.lane_stats(bulk)};
+}
+
+void print_priority_run(const PriorityScenario& scenario, size_t burst, const PriorityRun& run) {
+    auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+    std::stringstream ss;
+    ss.setf(std::ios::fixed);
+    ss.precision(1);
+    ss << "  " << scenario.name << std::string(20 - std::min<size_t>(19, std::strlen(scenario.name)), ' ')
+       << "burst " << burst << (burst < 10 ? "    " : burst < 100 ? "   " : "  ")
+       << "risk p50 " << us(run.risk.queue_delay.percentile(50)) << "us  p99 "
+       << us(run.risk.queue_delay.percentile(99)) << "us  p99.9 " << us(run.risk.queue_delay.percentile(99.9))
+       << "us | bulk p99 " << us(run.bulk.queue_delay.percentile(99)) << "us";
+    if (run.bulk.expired_dropped + run.bulk.expired_deferred > 0) {
+        ss << ", " << run.bulk.expired_dropped << " dropped, " << run.bulk.expired_deferred << " deferred";
+    }
+    ss << "\n";
+    std::cout << ss.str() << std::flush;
+}
+
+const std::vector<PriorityScenario>& priority_scenarios() {
+    static const std::vector<PriorityScenario> scenarios = {
+        {"FIFO (one lane)", false, LanePolicy{}, 0, ExpiryAction::Run},
+        {"strict lanes", true, LanePolicy{}, 0, ExpiryAction::Run},
+        {"weighted 8:4:1", true, LanePolicy{LaneOrder::Weighted, {8, 4, 1}}, 0, ExpiryAction::Run},
+        // Stale log lines are worthless: shed them instead of queueing them
+        {"strict, drop >1ms", true, LanePolicy{}, 1000000, ExpiryAction::Drop},
+        {"strict, defer >1ms", true, LanePolicy{}, 1000000, ExpiryAction::Defer},
+    };
+    return scenarios;
+}
+
+void demo_priority_lanes() {
+    const PriorityScenario& fifo = priority_scenarios()[0];
+    const PriorityScenario& strict = priority_scenarios()[1];
+    for (size_t burst : {0, 64}) {
+        print_priority_run(fifo, burst, run_priority_scenario(fifo, 4, burst, 200));
+        print_priority_run(strict, burst, run_priority_scenario(strict, 4, burst, 200));
+    }
+}
+
+// Run with: 10_hybrid_approach --bench-priority (or the bench_priority_lanes target)
+int run_priority_benchmark() {
+    const size_t threads = 4;
+    const int rounds = 2000;
+    std::cout << "=== Priority lanes: risk checks (" << kRiskCheckNs / 1000 << " us) behind bulk bursts ("
+              << kBulkTaskNs / 1000 << " us per task) ===\n"
+              << "One risk check per " << kPriorityRoundNs / 1000 << " us, " << rounds << " rounds, " << threads
+              << " workers (" << Topology::get().describe() << "); queue delay = submit -> start\n";
+    for (const PriorityScenario& scenario : priority_scenarios()) {
+        // Up to 128: ~64% busy; 512: the bulk backlog grows by the round
+        for (size_t burst : {0, 32, 128, 512}) {
+            if (scenario.bulk_deadline != 0 && burst < 128) {
+                continue; // Nothing expires without a backlog
+            }
+            print_priority_run(scenario, burst, run_priority_scenario(scenario, threads, burst, rounds));
+        }
+    }
+    return 0;
+}
+
+// Several feed threads submitting into one pool. With as many producers as
+// workers every inbox stays SPSC; with more, inboxes become MPMC rings.
+void demo_multi_feed_ingestion(size_t threads, size_t feeds) {
+    const int tasks_per_feed = 20000;
+    std::atomic<int> executed{0};
+    std::atomic<int> rejected{0};
+    {
+        // Reject: this demo retries and counts refusals itself
+        LockFreeThreadPool pool(PoolConfig{threads, SchedulingPolicy::RoundRobin, feeds, IdlePolicy{},
+                                           OverflowPolicy::with(OverflowPolicy::Mode::Reject)});
+
+        std::vector<std::thread> feed_threads;
+        for (size_t f = 0; f < feeds; ++f) {
+            feed_threads.emplace_back([&pool, &executed, &rejected] {
+                for (int i = 0; i < tasks_per_feed; ++i) {
+                    int attempts = 0;
+                    while (!pool.submit([&executed] {
+                        executed.fetch_add(1, std::memory_order_relaxed);
+                    })) {
+                        if (++attempts == 1000) {
+                            rejected.fetch_add(1, std::memory_order_relaxed);
+                            break;
+                        }
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (auto& t : feed_threads) {
+            t.join();
+        }
+    } // Pool destructor drains the inboxes
+
+    std::stringstream ss;
+    ss << "  " << feeds << " feeds -> " << threads << " workers: executed "
+       << executed.load() << " + rejected " << rejected.load() << " of "
+       << feeds * tasks_per_feed << " submitted\n";
+    std::cout << ss.str() << std::flush;
+}
+
+// A burst bigger than the inboxes (2 workers x 1024 slots) under each
+// overflow policy: what ran, what was lost, and which counter fired
+void demo_overflow_policies() {
+    const int burst = 20000;
+    const std::pair<OverflowPolicy::Mode, const char*> modes[] = {
+        {OverflowPolicy::Mode::Reject, "Reject:     "},
+        {OverflowPolicy::Mode::BlockSpin, "BlockSpin:  "},
+        {OverflowPolicy::Mode::Spill, "Spill:      "},
+        {OverflowPolicy::Mode::DropOldest, "DropOldest: "},
+        {OverflowPolicy::Mode::RunInline, "RunInline:  "},
+    };
+
+    for (const auto& [mode, name] : modes) {
+        std::atomic<int> executed{0};
+        OverflowStats stats;
+        {
+            LockFreeThreadPool pool(PoolConfig{2, SchedulingPolicy::RoundRobin, 1, IdlePolicy{},
+                                               OverflowPolicy::with(mode)});
+            for (int i = 0; i < burst; ++i) {
+                pool.submit([&executed] {
+                    spin_for(std::chrono::microseconds(1));
+                    executed.fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+            pool.drain();
+            stats = pool.overflow_stats();
+        }
+
+        std::stringstream ss;
+        ss << "  " << name << "executed " << executed.load() << " of " << burst
+           << " (rejected " << stats.rejected << ", blocked " << stats.blocked
+           << ", spilled " << stats.spilled << ", dropped " << stats.dropped
+           << ", inline " << stats.ran_inline << ")\n";
+        std::cout << ss.str() << std::flush;
+    }
+}
+
+// Microbenchmark: SPSCQueue vs CachedSPSCQueue
+// Run with: 10_hybrid_approach --bench-spsc (or the bench_spsc_queue target)
+
+// Producer and consumer on two distinct physical cores of the same node
+std::vector<WorkerPlacement> spsc_placement() {
+    const std::vector<int>& cpus = Topology::get().cpus_of_node(0);
+    return {WorkerPlacement{cpus[0], 0}, WorkerPlacement{cpus[1 % cpus.size()], 0}};
+}
+template<typename T, size_t N>
+size_t push_some(SPSCQueue<T, N>& queue, T* items, size_t count) {
+    size_t n = 0;
+    while (n < count && queue.enqueue(items[n])) {
+        ++n;
+    }
+    return n;
+}
+
+template<typename T, size_t N>
+size_t pop_some(SPSCQueue<T, N>& queue, T* items, size_t count) {
+    size_t n = 0;
+    while (n < count && queue.dequeue(items[n])) {
+        ++n;
+    }
+    return n;
+}
+
+template<typename T, size_t N>
+size_t push_some(CachedSPSCQueue<T, N>& queue, T* items, size_t count) {
+    if (count == 1) {
+        return queue.enqueue(std::move(items[0])) ? 1 : 0;
+    }
+    return queue.try_enqueue_bulk(items, count);
+}
+
+template<typename T, size_t N>
+size_t pop_some(CachedSPSCQueue<T, N>& queue, T* items, size_t count) {
+    if (count == 1) {
+        return queue.dequeue(items[0]) ? 1 : 0;
+    }
+    return queue.try_dequeue_bulk(items, count);
+}
+
+template<typename Queue>
+double spsc_ops_per_sec(size_t items, size_t batch, bool& pinned, bool& correct) {
+    auto queue = std::make_unique<Queue>();
+    const std::vector<WorkerPlacement> cpus = spsc_placement();
+    std::atomic<bool> producer_pinned{false};
+    std::atomic<bool> consumer_pinned{false};
+    uint64_t checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread consumer([&] {
+        consumer_pinned = apply_placement(cpus[1], ThreadPinning::Core);
+        std::vector<uint64_t> out(batch);
+        size_t received = 0;
+        while (received < items) {
+            size_t n = pop_some(*queue, out.data(), std::min(batch, items - received));
+            if (n == 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (size_t i = 0; i < n; ++i) {
+                checksum += out[i];
+            }
+            received += n;
+        }
+    });
+
+    std::thread producer([&] {
+        producer_pinned = apply_placement(cpus[0], ThreadPinning::Core);
+        std::vector<uint64_t> in(batch);
+        size_t sent = 0;
+        while (sent < items) {
+            size_t want = std::min(batch, items - sent);
+            for (size_t i = 0; i < want; ++i) {
+                in[i] = sent + i;
+            }
+            size_t done = 0;
+            while (done < want) {
+                size_t n = push_some(*queue, in.data() + done, want - done);
+                if (n == 0) {
+                    std::this_thread::yield();
+                }
+                done += n;
+            }
+            sent += want;
+        }
+    });
+
+    producer.join();
+    consumer.join();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+    pinned = producer_pinned && consumer_pinned;
+    correct = checksum == static_cast<uint64_t>(items) * (items - 1) / 2;
+    return items / elapsed.count();
+}
+
+int run_spsc_benchmark() {
+    const size_t items = 5000000;
+    const std::vector<WorkerPlacement> cpus = spsc_placement();
+
+    std::cout << "=== SPSC Queue Microbenchmark ===\n";
+    std::cout << "Items: " << items << ", producer on CPU " << cpus[0].cpu << ", consumer on CPU "
+              << cpus[1].cpu
+              << (cpus[0].cpu == cpus[1].cpu ? " (single core: results are not representative)" : "")
+              << "\n";
+
+    struct Variant {
+        const char* name;
+        double (*run)(size_t, size_t, bool&, bool&);
+        size_t batch;
+    };
+    const Variant variants[] = {
+        {"SPSCQueue (modulo, shared indices)", spsc_ops_per_sec<SPSCQueue<uint64_t, 1024>>, 1},
+        {"CachedSPSCQueue (masked, cached)", spsc_ops_per_sec<CachedSPSCQueue<uint64_t, 1024>>, 1},
+        {"CachedSPSCQueue bulk x32", spsc_ops_per_sec<CachedSPSCQueue<uint64_t, 1024>>, 32},
+    };
+
+    bool all_correct = true;
+    for (const auto& variant : variants) {
+        bool pinned = false;
+        bool correct = false;
+        double ops = variant.run(items, variant.batch, pinned, correct);
+        all_correct = all_correct && correct;
+
+        std::stringstream ss;
+        ss << "  " << variant.name << ": " << ops / 1e6 << " Mops/s"
+           << (pinned ? "" : " (unpinned)") << (correct ? "" : " CHECKSUM MISMATCH") << "\n";
+        std::cout << ss.str() << std::flush;
+    }
+    return all_correct ? 0 : 1;
+}
+
+// The event layout the trading system used before interning: the symbol is a
+// std::string. OSI option symbols are 21 characters, past the small-string
+// buffer, so every copy of this tick allocates.
+struct StringMarketTick {
+    std::string symbol;
+    double price;
+    uint64_t timestamp;
+    int volume;
+};
+
+// " 0.5 allocations/tick", or a note when this build does not count
+// (only 10_hybrid_approach_alloc does, see bench_alloc_counter.h)
+std::string allocations_per(uint64_t allocations, int operations, const char* unit) {
+    if (!kCountsAllocations) {
+        return std::string("allocations/") + unit + " not counted";
+    }
+    std::stringstream ss;
+    ss << static_cast<double>(allocations) / operations << " allocations/" << unit;
+    return ss.str();
+}
+
+// Microbenchmark: the TradingSystem fan-out (3 subscribers, one publish per
+// tick) with string ticks vs interned, trivially copyable ticks
+// Run with: 10_hybrid_approach_alloc --bench-events (or the bench_event_payloads
+// target); the plain build leaves out the allocation counts
+template<typename Tick, typename MakeTick>
+void run_event_workload(const char* name, MakeTick make_tick) {
+    const int ticks = 30000;
+    const int drain_every = 1000; // 3000 tasks in flight, inside the 4 x 1024 inbox slots
+
+    LockFreeThreadPool pool(4);
+    HighPerfEventBroker<Tick> broker(pool);
+    ShardedCounter signals;
+    ShardedCounter risks;
+    ShardedCounter logged;
+    broker.subscribe([&signals](const Tick& tick) {
+        signals.add(tick.timestamp % 3 == 0 ? 1 : 0);
+    });
+    broker.subscribe([&risks](const Tick& tick) {
+        risks.add(tick.volume > 1000 ? 1 : 0);
+    });
+    broker.subscribe([&logged](const Tick&) {
+        logged.add();
+    });
+
+    uint64_t allocations_before = allocation_count();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ticks; ++i) {
+        broker.publish(make_tick(i));
+        if (i % drain_every == drain_every - 1) {
+            broker.drain();
+        }
+    }
+    broker.drain();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t allocations = allocation_count() - allocations_before;
+
+    std::stringstream ss;
+    ss << "  " << name << static_cast<uint64_t>(ticks / elapsed.count()) << " ticks/s, "
+       << allocations_per(allocations, ticks, "tick") << " ("
+       << broker.get_callbacks_executed() << " callbacks)\n";
+    std::cout << ss.str() << std::flush;
+}
+
+// Large event: a 20-level order book. Too big to ride inside a task, so each
+// publish copies it once into an envelope shared by every subscriber.
+struct BookLevel {
+    Price price;
+    int64_t quantity;
+};
+
+struct OrderBookSnapshot {
+    SymbolId symbol;
+    uint64_t timestamp;
+    BookLevel bids[20];
+    BookLevel asks[20];
+};
+
+void run_order_book_fanout() {
+    const int snapshots = 20000;
+    const int subscribers = 8;
+    const int drain_every = 400; // 3200 tasks in flight
+
+    LockFreeThreadPool pool(4);
+    HighPerfEventBroker<OrderBookSnapshot> broker(pool);
+    std::atomic<int64_t> depth{0};
+    for (int i = 0; i < subscribers; ++i) {
+        broker.subscribe([&depth](const OrderBookSnapshot& book) {
+            depth.fetch_add(book.bids[0].quantity + book.asks[0].quantity, std::memory_order_relaxed);
+        });
+    }
+
+    OrderBookSnapshot book{};
+    for (int level = 0; level < 20; ++level) {
+        book.bids[level] = {to_price(100.0 - 0.01 * level), 100};
+        book.asks[level] = {to_price(100.01 + 0.01 * level), 100};
+    }
+
+    // Warm the envelope freelist, then measure the steady state
+    broker.publish(book);
+    broker.drain();
+    uint64_t allocations_before = allocation_count();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < snapshots; ++i) {
+        book.timestamp = static_cast<uint64_t>(i);
+        broker.publish(book);
+        if (i % drain_every == drain_every - 1) {
+            broker.drain();
+        }
+    }
+    broker.drain();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t allocations = allocation_count() - allocations_before;
+
+    std::stringstream ss;
+    ss << "  " << sizeof(OrderBookSnapshot) << "-byte order book, " << subscribers << " subscribers: "
+       << static_cast<uint64_t>(snapshots / elapsed.count()) << " publishes/s, "
+       << allocations_per(allocations, snapshots, "publish") << ", "
+       << sizeof(OrderBookSnapshot) << " bytes copied/publish (per-subscriber copies: "
+       << subscribers * sizeof(OrderBookSnapshot) << ")\n";
+    std::cout << ss.str() << std::flush;
+}
+
+// What instrumenting one dispatch costs: the clock read and the histogram
+// increment, measured separately
+void run_latency_recording_cost() {
+    const int samples = 10000000;
+    LatencyRecorder recorder;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < samples; ++i) {
+        recorder.record(static_cast<uint64_t>(i & 0xFFFFF));
+    }
+    std::chrono::duration<double, std::nano> record_only = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    uint64_t previous = latency_now();
+    for (int i = 0; i < samples; ++i) {
+        uint64_t now = latency_now();
+        recorder.record(now - previous);
+        previous = now;
+    }
+    std::chrono::duration<double, std::nano> with_clock = std::chrono::steady_clock::now() - start;
+
+    std::stringstream ss;
+    ss.precision(3);
+    ss << "  record():               " << record_only.count() / samples << " ns\n";
+    ss << "  latency_now() + record: " << with_clock.count() / samples << " ns\n";
+    ss << "  " << recorder.snapshot().count() << " samples merged\n";
+    std::cout << ss.str() << std::flush;
+}
+
+int run_event_payload_benchmark() {
+    std::cout << "=== Event payloads: std::string symbol vs interned SymbolId ===\n"
+              << "(hardware threads: " << std::thread::hardware_concurrency() << ")\n";
+    if (!kCountsAllocations) {
+        std::cout << "(allocations are only counted by 10_hybrid_approach_alloc, "
+                  << "see the bench_event_payloads target)\n";
+    }
+    count_allocations(true);
+
+    std::vector<std::string> option_symbols = {
+        "AAPL  250620C00150000", "MSFT  250620P00400000",
+        "GOOGL 250620C00140000", "AMZN  250620P00180000"};
+    SymbolTable table;
+    std::vector<SymbolId> ids;
+    for (const auto& symbol : option_symbols) {
+        ids.push_back(table.intern(symbol));
+    }
+
+    run_event_workload<StringMarketTick>("std::string symbol: ", [&](int i) {
+        return StringMarketTick{option_symbols[i % option_symbols.size()], 140.0 + (i % 50),
+                                static_cast<uint64_t>(i), 500 + (i % 1000)};
+    });
+    run_event_workload<MarketTick>("interned SymbolId:  ", [&](int i) {
+        return MarketTick{ids[i % ids.size()], 500 + (i % 1000), to_price(140.0 + (i % 50)),
+                          static_cast<uint64_t>(i)};
+    });
+
+    std::cout << "=== Fan-out of a large event through a shared envelope ===\n";
+    run_order_book_fanout();
+
+    count_allocations(false);
+
+    std::cout << "=== Latency recording cost ===\n";
+    run_latency_recording_cost();
+    return 0;
+}
+
+// CPU time burned by a pool that has nothing to do
+void demo_idle_policies() {
+    auto idle_cpu_ms = [](IdlePolicy idle) {
+        LockFreeThreadPool pool(PoolConfig{4, SchedulingPolicy::RoundRobin, 1, idle});
+        pool.submit([] {});
+        pool.drain();
+
+        std::clock_t cpu_start = std::clock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        return 1000.0 * (std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    };
+
+    double busy = idle_cpu_ms(IdlePolicy::busy_poll());
+    double park = idle_cpu_ms(IdlePolicy{});
+
+    std::stringstream ss;
+    ss << "CPU time used by 4 idle workers over 200ms of wall time\n";
+    ss << "  Busy-poll:        " << busy << "ms\n";
+    ss << "  Spin-then-park:   " << park << "ms\n";
+    std::cout << ss.str() << std::flush;
+}
+
+// The same work-stealing pool unpinned and pinned. On one NUMA node Core
+// mainly removes migrations; on several, Node and Core also keep each
+// worker's queues, and the tasks it steals first, on its own node.
+void demo_worker_placement() {
+    const int tasks = 20000;
+    std::cout << "Topology: " << Topology::get().describe() << "\n";
+    const std::pair<ThreadPinning, const char*> modes[] = {
+        {ThreadPinning::None, "Unpinned:      "},
+        {ThreadPinning::Core, "Pinned (core): "},
+        {ThreadPinning::Node, "Pinned (node): "},
+    };
+    for (const auto& [pinning, name] : modes) {
+        std::atomic<int> executed{0};
+        double per_sec = 0;
+        {
+            LockFreeThreadPool pool(PoolConfig{4, SchedulingPolicy::WorkStealing, 1, IdlePolicy{},
+                                               OverflowPolicy{}, false, pinning});
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < tasks; ++i) {
+                while (!pool.submit([&executed] {
+                    executed.fetch_add(1, std::memory_order_relaxed);
+                })) {
+                    std::this_thread::yield();
+                }
+            }
+            pool.drain();
+            per_sec = tasks / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        std::stringstream ss;
+        ss << "  " << name << executed.load() << " tasks, " << static_cast<long>(per_sec) << " tasks/s\n";
+        std::cout << ss.str() << std::flush;
+    }
+}
+
+// Many symbols, one interested subscriber each: a broadcast broker runs
+// every subscriber on every tick (they filter inside the callback), the keyed
+// broker only runs the one that asked for the symbol
+void demo_keyed_routing() {
+    const int num_symbols = 200;
+    const int ticks = 2000;
+    // Keeps the broadcast run's 200 tasks per tick inside the 4 x 1024 inbox slots
+    const int drain_every = 10;
+
+    SymbolTable symbol_table;
+    std::vector<SymbolId> ids;
+    for (int i = 0; i < num_symbols; ++i) {
+        ids.push_back(symbol_table.intern("SYM" + std::to_string(i)));
+    }
+
+    auto run_broadcast = [&] {
+        LockFreeThreadPool pool(4);
+        HighPerfEventBroker<MarketTick> broker(pool);
+        std::atomic<int> matched{0};
+        for (int i = 0; i < num_symbols; ++i) {
+            broker.subscribe([&matched, id = ids[i]](const MarketTick& tick) {
+                if (tick.symbol == id) {
+                    matched.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (int t = 0; t < ticks; ++t) {
+            broker.publish(MarketTick{ids[t % num_symbols], 1, to_price(100.0), static_cast<uint64_t>(t)});
+            if (t % drain_every == drain_every - 1) {
+                broker.drain();
+            }
+        }
+        broker.drain();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::stringstream ss;
+        ss << "  Broadcast:     " << broker.get_callbacks_executed() << " callbacks for "
+           << matched.load() << " matches, " << elapsed.count() << "ms\n";
+        std::cout << ss.str() << std::flush;
+    };
+
+    auto run_keyed = [&](bool pin) {
+        LockFreeThreadPool pool(4);
+        KeyedEventBroker<MarketTick> broker(symbol_table, pool, pin);
+        // Only touched by the symbol's pinned worker when pin is set
+        std::vector<int64_t> last_seen(num_symbols, -1);
+        std::atomic<bool> in_order{true};
+        for (int i = 0; i < num_symbols; ++i) {
+            broker.subscribe(ids[i], [&last_seen, &in_order, i, pin](const MarketTick& tick) {
+                if (!pin) {
+                    return;
+                }
+                auto seq = static_cast<int64_t>(tick.timestamp);
+                if (seq < last_seen[i]) {
+                    in_order.store(false, std::memory_order_relaxed);
+                }
+                last_seen[i] = seq;
+            });
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (int t = 0; t < ticks; ++t) {
+            int s = t % num_symbols;
+            broker.publish(ids[s], MarketTick{ids[s], 1, to_price(100.0), static_cast<uint64_t>(t)});
+            if (t % drain_every == drain_every - 1) {
+                broker.drain();
+            }
+        }
+        broker.drain();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::stringstream ss;
+        ss << (pin ? "  Keyed, pinned: " : "  Keyed:         ") << broker.get_callbacks_executed()
+           << " callbacks, " << elapsed.count() << "ms";
+        if (pin) {
+            ss << ", per-symbol order " << (in_order.load() ? "preserved" : "VIOLATED");
+        }
+        ss << "\n";
+        std::cout << ss.str() << std::flush;
+    };
+
+    std::stringstream ss;
+    ss << num_symbols << " symbols, 1 subscriber each, " << ticks << " ticks\n";
+    std::cout << ss.str() << std::flush;
+    run_broadcast();
+    run_keyed(false);
+    run_keyed(true);
+}
+
+// --bench-json pool config: workload.consumers workers, one producer slot
+// per producer thread and Spill, so every op runs and none is rejected
+PoolConfig bench_pool_config(const Workload& load, SchedulingPolicy policy) {
+    PoolConfig config{load.consumers, policy, load.producers};
+    config.overflow = OverflowPolicy::with(OverflowPolicy::Mode::Spill);
+    config.record_task_time = false;
+    config.lanes.record_queue_delay = false;
+    config.log_creation = false;
+    return config;
+}
+
+// Producers submit workload.ops tasks of task_ns busy work; latency is
+// submit -> task start
+void measure_lock_free_pool(BenchReport& report, SchedulingPolicy policy, const char* variant) {
+    const Workload& load = report.workload();
+    report.measure("LockFreeThreadPool", variant, [&](TrialTimer& timer, LatencyRecorder& latency) {
+        LockFreeThreadPool pool(bench_pool_config(load, policy));
+        timer.start();
+        std::vector<std::thread> producers;
+        for (size_t p = 0; p < load.producers; ++p) {
+            producers.emplace_back([&, p] {
+                for (uint64_t i = share_of(load.ops, load.producers, p); i > 0; --i) {
+                    pool.submit([&latency, work = load.task_ns, submitted = latency_now()] {
+                        latency.record(latency_now() - submitted);
+                        busy_work(work);
+                    });
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        pool.drain();
+        timer.stop();
+    });
+}
+
+// Producers publish workload.ops events of event_bytes to `subscribers`
+// callbacks of task_ns work each; latency is publish -> callback start
+void measure_high_perf_broker(BenchReport& report, SchedulingPolicy policy, const char* variant) {
+    const Workload& load = report.workload();
+    with_event_size(load.event_bytes, [&](auto bytes) {
+        using Event = BenchPayload<decltype(bytes)::value>;
+        report.measure("HighPerfEventBroker", variant, [&](TrialTimer& timer, LatencyRecorder& latency) {
+            LockFreeThreadPool pool(bench_pool_config(load, policy));
+            HighPerfEventBroker<Event> broker(pool);
+            for (size_t s = 0; s < load.subscribers; ++s) {
+                broker.subscribe([&latency, work = load.task_ns](const Event& event) {
+                    latency.record(latency_now() - event.sent_ns);
+                    busy_work(work);
+                });
+            }
+            timer.start();
+            std::vector<std::thread> producers;
+            for (size_t p = 0; p < load.producers; ++p) {
+                producers.emplace_back([&, p] {
+                    Event event{};
+                    for (uint64_t i = share_of(load.ops, load.producers, p); i > 0; --i) {
+                        event.sent_ns = latency_now();
+                        broker.publish(event);
+                    }
+                });
+            }
+            for (auto& producer : producers) {
+                producer.join();
+            }
+            broker.drain();
+            timer.stop();
+        });
+    });
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--bench-json") {
+        return run_bench_json(argc, argv, 2, "10_hybrid_approach", [](BenchReport& report) {
+            measure_lock_free_pool(report, SchedulingPolicy::RoundRobin, "round-robin");
+            measure_lock_free_pool(report, SchedulingPolicy::WorkStealing, "work-stealing");
+            measure_high_perf_broker(report, SchedulingPolicy::RoundRobin, "round-robin pool");
+            measure_high_perf_broker(report, SchedulingPolicy::WorkStealing, "work-stealing pool");
+        });
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-spsc") {
+        return run_spsc_benchmark();
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-events") {
+        return run_event_payload_benchmark();
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-pipeline") {
+        return run_pipeline_benchmark();
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-journal") {
+        return run_journal_benchmark();
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-priority") {
+        return run_priority_benchmark();
+    }
+
+    std::cout << "=== Hybrid Approach: High-Performance Trading System ===\n";
+    std::cout << "Combining:\n";
+    std::cout << "  - Lock-free thread pool with per-worker queues\n";
+    std::cout << "  - Lock-free publisher/subscriber with RCU\n";
+    std::cout << "  - Parallel event dispatch\n\n";
+
+    TradingSystem system(4);
+
+    std::cout << "--- Simulating Market Data Feed ---\n";
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Simulate incoming market data, delivered in batches as a feed handler
+    // would after reading a packet
+    std::vector<SymbolId> symbols;
+    for (const char* name : {"AAPL", "GOOGL", "MSFT", "AMZN"}) {
+        symbols.push_back(system.intern(name));
+    }
+    const size_t batch_size = 50;
+    std::vector<MarketTick> batch;
+    batch.reserve(batch_size);
+    
+    for (int i = 0; i < 1000; ++i) {
+        batch.push_back(MarketTick{
+            symbols[i % symbols.size()],
+            500 + (i % 1000),
+            to_price(140.0 + (i % 50)),
+            static_cast<uint64_t>(i)
+        });
+        
+        if (batch.size() == batch_size) {
+            system.process_ticks(batch);
+            batch.clear();
+        }
+        
+        if (i % 250 == 0) {
+            std::cout << "  Processed " << i << " ticks...\n";
+        }
+    }
+    system.process_ticks(batch);
+
+    std::cout << "  All ticks submitted (non-blocking)\n";
+    std::cout << "  Waiting for processing to complete...\n";
+
+    system.wait_until_processed();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = end - start;
+
+    system.print_stats();
+    
+    std::cout << "\nProcessing time: " << duration.count() << "ms\n";
+    std::cout << "Throughput: " << (1000.0 / duration.count() * 1000) << " ticks/sec"
+              << " (measured until drain() returned)\n";
+
+    benchmark_scheduling();
+
+    std::cout << "\n--- Pipeline Mode: strategy -> risk -> log ---\n";
+    demo_pipeline_mode();
+
+    std::cout << "\n--- Event Journal: record and replay ---\n";
+    demo_event_journal();
+
+    std::cout << "\n--- Priority Lanes: risk checks vs a logging burst ---\n";
+    demo_priority_lanes();
+
+    std::cout << "\n--- Multi-Feed Ingestion ---\n";
+    demo_multi_feed_ingestion(4, 4);
+    demo_multi_feed_ingestion(4, 8);
+
+    std::cout << "\n--- Overflow Policies ---\n";
+    demo_overflow_policies();
+
+    std::cout << "\n--- Keyed Routing ---\n";
+    demo_keyed_routing();
+
+    std::cout << "\n--- Idle Policy ---\n";
+    demo_idle_policies();
+
+    std::cout << "\n--- Worker Placement ---\n";
+    demo_worker_placement();
 
     std::cout << "\n=== Key Benefits of Hybrid Approach ===\n";
     std::cout << "  1. Lock-free queues eliminate contention\n";
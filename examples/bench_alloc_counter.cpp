@@ -0,0 +1,45 @@
+// Replacement global operator new for the <example>_alloc builds
+// See bench_alloc_counter.h; linked only by add_example(... COUNT_ALLOCATIONS)
+
+#include "bench_alloc_counter.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "sharded_counter.h"
+
+namespace {
+
+std::atomic<bool> counting{false};
+ShardedCounter allocations; // Constant-initialised: safe before main
+
+} // namespace
+
+void count_allocations(bool enabled) {
+    counting.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t allocation_count() {
+    return allocations.load();
+}
+
+// The array, nothrow and sized forms all default to these two
+void* operator new(std::size_t size) {
+    if (counting.load(std::memory_order_relaxed)) {
+        allocations.add();
+    }
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
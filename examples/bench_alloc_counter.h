@@ -0,0 +1,41 @@
+// Heap allocation counting for the benchmark builds of the examples
+// Used by bench_harness.h (--bench-json) and the --bench-events mode of 10
+// Topics: replacing the global operator new, opt-in instrumentation
+//
+// Counting allocations means replacing the global operator new, which every
+// allocation of the program then goes through. So the replacement lives in
+// bench_alloc_counter.cpp and is only linked into the <example>_alloc
+// builds (COUNT_ALLOCATIONS in CMakeLists.txt), which also define
+// BENCH_COUNT_ALLOCATIONS. Everywhere else the functions below are no-ops:
+// the demos, the --bench modes and the heap baselines they compare against
+// run on the unmodified allocator.
+//
+// Even in an _alloc build nothing is counted until count_allocations(true);
+// then each thread adds into its own ShardedCounter slot, so counting puts
+// no shared cache line on the allocation path. Over-aligned new is not
+// counted.
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(BENCH_COUNT_ALLOCATIONS)
+
+constexpr bool kCountsAllocations = true;
+
+void count_allocations(bool enabled);
+
+// Allocations made while counting was enabled, summed over all threads
+uint64_t allocation_count();
+
+#else
+
+constexpr bool kCountsAllocations = false;
+
+inline void count_allocations(bool) {}
+
+inline uint64_t allocation_count() {
+    return 0;
+}
+
+#endif
@@ -0,0 +1,253 @@
+// BenchHarness: shared workloads, measurement and JSON output for the --bench-json modes
+// Used by 01, 02, 05, 06, 08 and 10, and driven by the bench_all target (run_benchmarks.cmake)
+// Topics: parameterised workloads, latency percentiles, allocation counting, JSON lines
+//
+// The examples' own --bench modes each measure something different in their
+// own units, so nothing can be compared across files. In --bench-json mode
+// every example instead runs one Workload (parsed from --key=value flags)
+// against its components and writes one JSON object per line and variant:
+// ops/s over repeated trials, latency percentiles and heap allocations per
+// op. Latency follows each operation's own path: submit -> task start for
+// pools, enqueue -> dequeue for queues, publish -> callback for brokers.
+// Work is a busy loop, never a sleep, and nothing prints while it runs.
+//
+// Allocations are only counted in the <example>_alloc builds, which link
+// the replacement operator new of bench_alloc_counter.cpp (bench_all uses
+// those); elsewhere allocations_per_op is null.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "bench_alloc_counter.h"
+#include "latency_histogram.h"
+
+// One point of the benchmark matrix. Each component uses the knobs that
+// apply to it (a pool has no subscribers); all of them are reported.
+struct Workload {
+    uint64_t ops = 100000;   // Tasks submitted, items enqueued or events published per trial
+    uint64_t task_ns = 0;    // Busy work per task, dequeued item or callback
+    size_t producers = 1;    // Submitting, enqueuing or publishing threads
+    size_t consumers = 4;    // Pool workers, or dequeuing threads
+    size_t subscribers = 4;  // Callbacks per event (brokers)
+    size_t event_bytes = 64; // Item / event size: 16, 64, 256 or 1024
+    int trials = 3;
+};
+
+// Spin for ns nanoseconds of wall time: a stand-in for real work that
+// keeps the core busy instead of handing it back like sleep_for would
+inline void busy_work(uint64_t ns) {
+    if (ns == 0) {
+        return;
+    }
+    const uint64_t until = latency_now() + ns;
+    while (latency_now() < until) {
+    }
+}
+
+// Trivially copyable item of exactly Bytes bytes, stamped when produced
+template<size_t Bytes>
+struct BenchPayload {
+    static_assert(Bytes >= 16, "payload needs room for its header");
+    uint64_t sent_ns;
+    uint64_t sequence;
+    unsigned char body[Bytes - 16];
+};
+
+template<>
+struct BenchPayload<16> {
+    uint64_t sent_ns;
+    uint64_t sequence;
+};
+
+// Calls f(std::integral_constant<size_t, N>{}) for the workload's event
+// size, so a generic lambda can name BenchPayload<N>
+template<typename F>
+void with_event_size(size_t bytes, F&& f) {
+    switch (bytes) {
+    case 16: f(std::integral_constant<size_t, 16>{}); return;
+    case 64: f(std::integral_constant<size_t, 64>{}); return;
+    case 256: f(std::integral_constant<size_t, 256>{}); return;
+    case 1024: f(std::integral_constant<size_t, 1024>{}); return;
+    }
+    throw std::invalid_argument("--event-bytes must be 16, 64, 256 or 1024");
+}
+
+// Splits total ops between n threads; thread i's share
+inline uint64_t share_of(uint64_t total, size_t n, size_t i) {
+    return total / n + (i < total % n ? 1 : 0);
+}
+
+// Brackets the measured part of one trial; setup and teardown stay outside
+class TrialTimer {
+public:
+    void start() {
+        allocations_at_start = allocation_count();
+        started = latency_now();
+    }
+
+    void stop() {
+        stopped = latency_now();
+        allocations_at_stop = allocation_count();
+    }
+
+    double seconds() const { return static_cast<double>(stopped - started) / 1e9; }
+    uint64_t allocations() const { return allocations_at_stop - allocations_at_start; }
+
+private:
+    uint64_t started = 0;
+    uint64_t stopped = 0;
+    uint64_t allocations_at_start = 0;
+    uint64_t allocations_at_stop = 0;
+};
+
+// Writes the records of one example run
+class BenchReport {
+public:
+    BenchReport(std::ostream& output, std::string example_name, const Workload& workload)
+        : out(output), example(std::move(example_name)), load(workload) {}
+
+    const Workload& workload() const { return load; }
+
+    // run(timer, latency) performs one trial of load.ops operations: it
+    // sets up, calls timer.start(), runs everything to completion, calls
+    // timer.stop() and tears down. One sample per operation (or delivery)
+    // goes to latency.
+    template<typename Run>
+    void measure(const std::string& component, const std::string& variant, Run&& run) {
+        LatencyRecorder latency;
+        std::vector<double> rates;
+        uint64_t allocations = 0;
+        for (int t = 0; t < load.trials; ++t) {
+            TrialTimer timer;
+            run(timer, latency);
+            rates.push_back(static_cast<double>(load.ops) / std::max(timer.seconds(), 1e-9));
+            allocations += timer.allocations();
+        }
+        write(component, variant, rates, latency.snapshot(), allocations);
+    }
+
+private:
+    std::ostream& out;
+    const std::string example;
+    const Workload load;
+
+    static std::string quoted(const std::string& text) {
+        std::string result = "\"";
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+            }
+            result += c;
+        }
+        return result + "\"";
+    }
+
+    void write(const std::string& component, const std::string& variant, const std::vector<double>& rates,
+               const LatencyHistogram& latency, uint64_t allocations) {
+        double mean = 0.0;
+        for (double rate : rates) {
+            mean += rate / static_cast<double>(rates.size());
+        }
+        double variance = 0.0;
+        for (double rate : rates) {
+            variance += (rate - mean) * (rate - mean) / static_cast<double>(rates.size());
+        }
+        const double ops = static_cast<double>(load.ops) * static_cast<double>(rates.size());
+
+        std::stringstream ss;
+        ss << "{\"example\":" << quoted(example) << ",\"component\":" << quoted(component)
+           << ",\"variant\":" << quoted(variant) << ",\"workload\":{\"ops\":" << load.ops
+           << ",\"task_ns\":" << load.task_ns << ",\"producers\":" << load.producers
+           << ",\"consumers\":" << load.consumers << ",\"subscribers\":" << load.subscribers
+           << ",\"event_bytes\":" << load.event_bytes << "},\"trials\":" << rates.size()
+           << ",\"ops_per_sec\":" << static_cast<uint64_t>(mean)
+           << ",\"ops_per_sec_cv\":" << (mean > 0.0 ? std::sqrt(variance) / mean : 0.0)
+           << ",\"latency_ns\":{\"p50\":" << latency.percentile(50) << ",\"p99\":" << latency.percentile(99)
+           << ",\"p999\":" << latency.percentile(99.9) << ",\"max\":" << latency.max()
+           << ",\"samples\":" << latency.count() << "},\"allocations_per_op\":";
+        if (kCountsAllocations) {
+            ss << static_cast<double>(allocations) / ops;
+        } else {
+            ss << "null";
+        }
+        ss << "}\n";
+        out << ss.str() << std::flush;
+    }
+};
+
+// Entry point of a --bench-json mode: argv[first..] are --key=value flags
+// (--ops, --task-ns, --producers, --consumers, --subscribers, --event-bytes,
+// --trials, --out). Records go to --out (appended) or stdout; bad flags
+// print usage and return 2. run(report) calls report.measure() per variant.
+template<typename Run>
+int run_bench_json(int argc, char* argv[], int first, const char* example, Run&& run) {
+    Workload workload;
+    std::string out_path;
+    try {
+        for (int i = first; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const size_t eq = arg.find('=');
+            if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+                throw std::invalid_argument("expected --key=value, got " + arg);
+            }
+            const std::string key = arg.substr(2, eq - 2);
+            const std::string value = arg.substr(eq + 1);
+            if (key == "out") {
+                out_path = value;
+                continue;
+            }
+            const uint64_t number = std::stoull(value);
+            if (key == "ops") {
+                workload.ops = number;
+            } else if (key == "task-ns") {
+                workload.task_ns = number;
+            } else if (key == "producers") {
+                workload.producers = static_cast<size_t>(number);
+            } else if (key == "consumers") {
+                workload.consumers = static_cast<size_t>(number);
+            } else if (key == "subscribers") {
+                workload.subscribers = static_cast<size_t>(number);
+            } else if (key == "event-bytes") {
+                workload.event_bytes = static_cast<size_t>(number);
+                with_event_size(workload.event_bytes, [](auto) {}); // Validate
+            } else if (key == "trials") {
+                workload.trials = static_cast<int>(number);
+            } else {
+                throw std::invalid_argument("unknown option --" + key);
+            }
+        }
+        if (workload.ops == 0 || workload.producers == 0 || workload.consumers == 0 || workload.trials <= 0) {
+            throw std::invalid_argument("ops, producers, consumers and trials must be positive");
+        }
+    } catch (const std::exception& error) {
+        std::cerr << example << " --bench-json: " << error.what() << "\n"
+                  << "options: --ops=N --task-ns=N --producers=N --consumers=N --subscribers=N"
+                  << " --event-bytes=16|64|256|1024 --trials=N --out=FILE\n";
+        return 2;
+    }
+
+    std::ofstream file;
+    if (!out_path.empty()) {
+        file.open(out_path, std::ios::app);
+        if (!file) {
+            std::cerr << example << " --bench-json: cannot open " << out_path << "\n";
+            return 2;
+        }
+    }
+    BenchReport report(out_path.empty() ? std::cout : file, example, workload);
+    count_allocations(true);
+    run(report);
+    count_allocations(false);
+    return 0;
+}
@@ -1,13 +1,20 @@
 #include <coroutine>
-#include <condition_variable>
 #include <atomic>
+#include <cstdint>
 #include <deque>
 #include <exception>
+#include <latch>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <utility>
 #include <vector>
 
+#include "coroutine_frame_pool.h"
+#include "event_stream.h"
+#include "topology.h"
+#include "work_stealing_deque.h"
+
 // Forward-declare
 struct ThreadPool;
 
@@ -15,11 +22,22 @@ struct ThreadPool;
 // Task: a void-returning coroutine that runs on a ThreadPool
 //--------------------------------------------------------------
 struct Task {
-  struct promise_type {
-    // ThreadPool* pool = nullptr;              // set by spawn()
+  // Frames are recycled through CoroutineFramePool: no malloc per spawn
+  struct promise_type : PooledCoroutineFrame {
+    ThreadPool* pool = nullptr;              // set by spawn(), moved by resume_on()
+
+    // Destroys the finished coroutine and tells its pool. Done here rather
+    // than by the worker after resume(): once a coroutine has re-queued
+    // itself another worker may already be running (or destroying) it.
+    struct FinalAwaiter {
+      bool await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<promise_type> h) const noexcept;
+      void await_resume() const noexcept {}
+    };
+
     Task get_return_object() noexcept;
     std::suspend_always initial_suspend() noexcept { return {}; } // start suspended
-    std::suspend_always final_suspend() noexcept { return {}; }   // worker will destroy
+    FinalAwaiter final_suspend() noexcept { return {}; }          // destroys itself
     void return_void() noexcept {}
     void unhandled_exception() { std::terminate(); }
   };
@@ -55,45 +73,63 @@ inline Task Task::promise_type::get_return_object() noexcept {
 
 //--------------------------------------------------------------
 // ThreadPool: schedules coroutine handles
+//
+// Every worker owns a FIFO work-stealing deque (work_stealing_deque.h). A
+// coroutine that yields on a worker goes back onto that worker's deque -- a
+// plain store and a release, no lock. It only pays for a wake-up (a seq_cst
+// fence, plus a notify if someone sleeps) when the deque was empty before;
+// with other work queued behind it, awake peers steal without being told.
+// Taking it back out is not free: the owner takes from the same end as
+// thieves, a fence and a CAS per resume, so that a yield goes behind the
+// work already queued instead of straight back on (as a LIFO owner pop would). Idle
+// workers steal from their peers, then park on a futex (C++20 atomic wait). Only handles arriving
+// from outside the pool (spawn() from another thread, resume_on() from
+// another pool) go through the small locked injection queue.
+//
+// With pinning (topology.h) every NUMA node gets its own injection queue,
+// outside submitters use the one of the node they run on, and workers look
+// on their own node -- deque, injection queue, peers -- before any other.
 //--------------------------------------------------------------
 struct ThreadPool {
   using coro_handle = std::coroutine_handle<Task::promise_type>;
 
-  explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency())
-  : stop_(false), drained_(false), pending_(0) {
+  explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency(),
+                      ThreadPinning pinning = ThreadPinning::None)
+  : started_(static_cast<std::ptrdiff_t>(threads == 0 ? 1 : threads) + 1),
+    stop_(false), drained_(false), pending_(0) {
     if (threads == 0) threads = 1;
-    workers_.reserve(threads);
+    const std::size_t nodes = pinning == ThreadPinning::None ? 1 : Topology::get().node_count();
+    for (std::size_t n = 0; n < nodes; ++n) inject_.push_back(std::make_unique<Injection>());
+
+    // Each worker allocates its own Worker (deque included) once pinned, so
+    // the pages are first touched on its node. Nobody runs, and the
+    // constructor does not return, until every deque exists.
+    const std::vector<WorkerPlacement> plan = plan_workers(threads, pinning);
+    workers_.resize(threads);
     for (std::size_t i = 0; i < threads; ++i) {
-      workers_.emplace_back([this]{ worker_loop(); });
+      threads_.emplace_back([this, i, pinning, placement = plan[i]] {
+        apply_placement(placement, pinning);
+        workers_[i] = std::make_unique<Worker>(placement.node);
+        started_.arrive_and_wait();
+        worker_loop(i);
+      });
     }
+    started_.arrive_and_wait();
   }
 
   ThreadPool(const ThreadPool&) = delete;
   ThreadPool& operator=(const ThreadPool&) = delete;
 
   ~ThreadPool() {
-    // graceful shutdown
-    {
-      std::unique_lock lk(m_);
-      stop_ = true;
-      cv_.notify_all();
-    }
-    for (auto& t : workers_) t.join();
-
-    // Drain any left-over (shouldn’t happen if wait_idle() was used)
-    while (true) {
-      coro_handle h;
-      {
-        std::lock_guard lk(m_);
-        if (q_.empty()) break;
-        h = q_.front(); q_.pop_front();
-      }
-      if (h) {
-        // If something remained, destroy safely
-        if (!h.done()) { h.resume(); }
-        if (h && h.done()) h.destroy();
-      }
-    }
+    // graceful shutdown: workers drain every queue before they exit
+    stop_.store(true, std::memory_order_release);
+    wake_epoch_.fetch_add(1, std::memory_order_release);
+    wake_epoch_.notify_all();
+    for (auto& t : threads_) t.join();
+
+    // Drain any left-over (only tasks queued after the workers exited)
+    coro_handle h;
+    while (take_injected_(h)) h.destroy();
   }
 
   // Spawn a new Task on this pool.
@@ -103,17 +139,9 @@ struct ThreadPool {
     t = Task{}; // release ownership; pool will own/destroy
     if (!h) return;
 
-    {
-      std::lock_guard lk(m_);
-      ++pending_;
-      // annotate promise with this pool, so yield can re-enqueue
-      if (h.address()) {
-        [[maybe_unused]] auto& prom = h.promise();
-        //prom.pool = this;
-      }
-      q_.push_back(h);
-    }
-    cv_.notify_one();
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    h.promise().pool = this; // lets the final suspend report back here
+    enqueue_(h);
   }
 
   // Awaitable that re-enqueues the current coroutine once, then suspends.
@@ -130,71 +158,236 @@ struct ThreadPool {
 
   [[nodiscard]] YieldOnce yield_once() noexcept { return YieldOnce{ *this }; }
 
+  // Awaitable that moves the current Task to this pool; the rest of the
+  // coroutine runs on its workers and counts towards its wait_idle().
+  struct ResumeOn {
+    ThreadPool& pool;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<Task::promise_type> h) const noexcept {
+      pool.adopt_(h);
+    }
+    void await_resume() const noexcept {}
+  };
+
+  // Make a Task of this pool runnable again after it suspended on something
+  // outside the pool (an EventStream, see event_stream.h). Any thread.
+  void schedule(std::coroutine_handle<> h) noexcept {
+    enqueue_(coro_handle::from_address(h.address()));
+  }
+
   // Wait until all spawned tasks have completed and the queue is empty.
+  // pending_ only reaches zero when the last task has destroyed itself, so
+  // no lock is needed: sleep on the counter until it does.
   void wait_idle() {
-    std::unique_lock lk(m_);
-    cv_idle_.wait(lk, [this]{
-      return pending_ == 0 && q_.empty();
-    });
+    for (auto n = pending_.load(std::memory_order_acquire); n != 0;
+         n = pending_.load(std::memory_order_acquire)) {
+      pending_.wait(n, std::memory_order_acquire);
+    }
+  }
+
+  std::size_t thread_count() const noexcept { return workers_.size(); }
+
+  // Coroutines resumed by each worker so far
+  std::vector<std::uint64_t> resumes_per_worker() const {
+    std::vector<std::uint64_t> counts;
+    for (const auto& w : workers_) counts.push_back(w->resumed.load(std::memory_order_relaxed));
+    return counts;
   }
 
 private:
   friend struct Task::promise_type;
 
+  static constexpr std::uint32_t kIdleRounds = 64; // yield() polls before parking
+  static constexpr std::size_t kInjectBatch = 64;  // handles moved per injection grab
+
+  struct Worker {
+    explicit Worker(std::size_t n) : node(n) {}
+    WorkStealingDeque<coro_handle, 1024> local;
+    const std::size_t node;
+    std::atomic<std::uint64_t> resumed{0}; // written only by this worker
+  };
+
+  struct Injection {
+    std::mutex m;                       // guards q only
+    std::deque<coro_handle> q;
+    alignas(64) std::atomic<std::size_t> count{0}; // lets workers skip the lock
+  };
+
+  static inline thread_local ThreadPool* current_pool_ = nullptr;
+  static inline thread_local std::size_t current_index_ = 0;
+
   void enqueue_(coro_handle h) noexcept {
-    // NOTE: await_suspend can be called concurrently; guard push with mutex.
-    std::lock_guard lk(m_);
-    q_.push_back(h);
-    cv_.notify_one();
+    // An own worker pushes onto its deque; anyone else injects on its node.
+    // A push onto a deque that already held work wakes nobody: the owner is
+    // awake and runs it, and whoever was woken for the earlier work steals.
+    if (current_pool_ == this) {
+      WorkStealingDeque<coro_handle, 1024>& local = workers_[current_index_]->local;
+      const bool had_work = !local.empty();
+      if (local.push(h)) {
+        if (!had_work) wake_one_();
+        return;
+      }
+    }
+    {
+      const std::size_t node = current_pool_ == this ? workers_[current_index_]->node
+                                                     : Topology::get().current_node();
+      Injection& in = *inject_[node < inject_.size() ? node : 0];
+      std::lock_guard lk(in.m);
+      in.q.push_back(h);
+      in.count.fetch_add(1, std::memory_order_release);
+    }
+    wake_one_();
   }
 
-  void worker_loop() {
-    for (;;) {
-      coro_handle h;
-      {
-        std::unique_lock lk(m_);
-        cv_.wait(lk, [this]{ return stop_ || !q_.empty(); });
-        if (stop_ && q_.empty()) break;
-        h = q_.front(); q_.pop_front();
+  // Take over h from the pool it currently belongs to
+  void adopt_(coro_handle h) noexcept {
+    ThreadPool* from = h.promise().pool;
+    if (from != this) {
+      pending_.fetch_add(1, std::memory_order_relaxed); // counted here before it stops counting there
+      h.promise().pool = this;
+    }
+    enqueue_(h); // h may run (and finish) from here on
+    if (from && from != this) from->task_finished_();
+  }
+
+  void task_finished_() noexcept {
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      pending_.notify_all();
+    }
+  }
+
+  bool take_injected_(coro_handle& h) {
+    for (auto& in : inject_) {
+      if (in->count.load(std::memory_order_acquire) == 0) continue;
+      std::lock_guard lk(in->m);
+      if (in->q.empty()) continue;
+      h = in->q.front(); in->q.pop_front();
+      in->count.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+    return false;
+  }
+
+  // Move a batch from an injection queue onto our deque (so peers can
+  // steal it) and take one
+  bool grab_injected_(Injection& in, Worker& me, coro_handle& h) {
+    if (in.count.load(std::memory_order_acquire) == 0) return false;
+    {
+      std::lock_guard lk(in.m);
+      for (std::size_t n = 0; n < kInjectBatch && !in.q.empty() && !me.local.full(); ++n) {
+        me.local.push(in.q.front());
+        in.q.pop_front();
+        in.count.fetch_sub(1, std::memory_order_relaxed);
       }
+    }
+    return me.local.steal(h);
+  }
 
-      if (h) {
-        h.resume();
+  // Own deque, then this node's injection queue and peers, then the
+  // other nodes' (one node when unpinned)
+  bool find_work_(std::size_t self, coro_handle& h) {
+    Worker& me = *workers_[self];
+    if (me.local.steal(h)) return true; // oldest first, same CAS as a thief
+    for (bool same_node : {true, false}) {
+      for (std::size_t n = 0; n < inject_.size(); ++n) {
+        if ((n == me.node) == same_node && grab_injected_(*inject_[n], me, h)) return true;
+      }
+      for (std::size_t i = 1; i < workers_.size(); ++i) {
+        Worker& peer = *workers_[(self + i) % workers_.size()];
+        if ((peer.node == me.node) == same_node && peer.local.steal(h)) return true;
+      }
+    }
+    return false;
+  }
+
+  bool has_work_() const {
+    for (const auto& in : inject_) {
+      if (in->count.load(std::memory_order_acquire) != 0) return true;
+    }
+    for (const auto& w : workers_) {
+      if (!w->local.empty()) return true;
+    }
+    return false;
+  }
 
-        if (h.done()) {
-          // destroy & mark completion
-          [[maybe_unused]] auto& promise = static_cast<Task::promise_type&>(h.promise());
-          h.destroy();
-
-          // pending_ corresponds to “live tasks”
-          // Only decrement on true completion (final_suspend observed).
-          std::lock_guard lk(m_);
-          if (--pending_ == 0 && q_.empty()) {
-            cv_idle_.notify_all();
-          }
-        }
-        // else: coroutine suspended; it re-enqueued itself via yield_once()
+  void wake_one_() {
+    // Pairs with the fence in park_(): either we see the sleeper or it
+    // sees the work we just published
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_relaxed) > 0) {
+      wake_epoch_.fetch_add(1, std::memory_order_release);
+      wake_epoch_.notify_one();
+    }
+  }
+
+  void park_() {
+    auto epoch = wake_epoch_.load(std::memory_order_acquire);
+    sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!has_work_() && !stop_.load(std::memory_order_acquire)) {
+      wake_epoch_.wait(epoch, std::memory_order_acquire);
+    }
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void worker_loop(std::size_t self) {
+    current_pool_ = this;
+    current_index_ = self;
+    Worker& me = *workers_[self];
+    std::uint32_t idle_rounds = 0;
+    for (;;) {
+      coro_handle h;
+      if (find_work_(self, h)) {
+        idle_rounds = 0;
+        // A finished task destroys itself in final_suspend; a suspended
+        // one has already re-queued itself, so h is not touched again
+        h.resume();
+        me.resumed.store(me.resumed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        continue;
+      }
+      if (stop_.load(std::memory_order_acquire) && !has_work_()) break;
+      if (++idle_rounds < kIdleRounds) {
+        std::this_thread::yield();
+      } else {
+        park_();
+        idle_rounds = 0;
       }
     }
   }
 
   // Shared state
-  mutable std::mutex m_;
-  std::condition_variable cv_;
-  std::condition_variable cv_idle_;
-  std::deque<coro_handle> q_;
-  std::vector<std::thread> workers_;
-
-  bool stop_;
+  std::latch started_;                           // workers + constructor
+  std::vector<std::unique_ptr<Worker>> workers_; // each filled in by its own thread
+  std::vector<std::thread> threads_;
+  std::vector<std::unique_ptr<Injection>> inject_; // one per NUMA node when pinned
+  alignas(64) std::atomic<std::uint32_t> sleepers_{0};
+  std::atomic<std::uint32_t> wake_epoch_{0};
+
+  std::atomic<bool> stop_;
   [[maybe_unused]] bool drained_;
-  std::atomic<std::size_t> pending_;
+  alignas(64) std::atomic<std::size_t> pending_;
 };
 
+inline void Task::promise_type::FinalAwaiter::await_suspend(
+    std::coroutine_handle<promise_type> h) const noexcept {
+  ThreadPool* pool = h.promise().pool;
+  if (!pool) return; // never spawned: the owning Task destroys it
+  h.destroy();
+  pool->task_finished_();
+}
+
+// Usage inside a Task: co_await resume_on(other_pool);
+[[nodiscard]] inline ThreadPool::ResumeOn resume_on(ThreadPool& pool) noexcept {
+  return ThreadPool::ResumeOn{ pool };
+}
+
 //--------------------------------------------------------------
 // Example usage (put this in your .cpp to test)
 //--------------------------------------------------------------
+#include <chrono>
 #include <iostream>
 #include <sstream>
+#include <string>
 
 Task stepper(ThreadPool& pool, int id, int steps, int work_ms) {
   // On spawn(), we start suspended and only run when a worker resumes us.
@@ -213,7 +406,200 @@ Task stepper(ThreadPool& pool, int id, int steps, int work_ms) {
   // return_void(): completion will be detected by the worker and the coroutine destroyed
 }
 
-int main() {
+// Starts on one pool, hops to the other and back
+Task hopper(ThreadPool& cpu, ThreadPool& io, int id) {
+  co_await resume_on(io);
+  {
+    std::stringstream ss;
+    ss << "[hopper " << id << "] on io pool, thread " << std::this_thread::get_id() << "\n";
+    std::cout << ss.str() << std::flush;
+  }
+  co_await resume_on(cpu);
+  {
+    std::stringstream ss;
+    ss << "[hopper " << id << "] back on cpu pool, thread " << std::this_thread::get_id() << "\n";
+    std::cout << ss.str() << std::flush;
+  }
+}
+
+// Yield throughput: every yield goes back to the current worker's deque
+Task spinner(ThreadPool& pool, int yields) {
+  for (int i = 0; i < yields; ++i) co_await pool.yield_once();
+}
+
+int run_yield_benchmark() {
+  std::cout << "=== Coroutine ThreadPool: yield_once() resumes per second ===\n"
+            << "(" << Topology::get().describe() << ")\n";
+  const int tasks = 1000;
+  const int yields = 1000;
+  for (std::size_t threads : {1, 2, 4, 8}) {
+    for (ThreadPinning pinning : {ThreadPinning::None, ThreadPinning::Core}) {
+      ThreadPool pool(threads, pinning);
+      auto frames_before = CoroutineFramePool::stats();
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < tasks; ++i) pool.spawn(spinner(pool, yields));
+      pool.wait_idle();
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+      auto per_worker = pool.resumes_per_worker();
+      auto frames = CoroutineFramePool::stats();
+      std::stringstream ss;
+      ss << "  " << threads << " workers"
+         << (pinning == ThreadPinning::None ? ", unpinned: " : ", pinned:   ")
+         << static_cast<long>(static_cast<double>(tasks) * (yields + 1) / elapsed.count() / 1e3)
+         << "K resumes/s, per worker:";
+      for (auto n : per_worker) ss << " " << n;
+      ss << ", frame mallocs " << frames.misses - frames_before.misses << "/" << tasks << "\n";
+      std::cout << ss.str() << std::flush;
+    }
+  }
+  return 0;
+}
+
+// Stream subscribers: each consumer is a Task looping over its own
+// EventStream and keeping its state (a running VWAP of one symbol) in its
+// frame. Thousands of them share the pool's few threads; a consumer only
+// occupies one while it has events to work through.
+struct StreamTick {
+  std::uint32_t symbol;
+  std::uint32_t size;
+  double price;
+  std::uint64_t sequence;
+};
+
+constexpr std::uint32_t kStreamSymbols = 100;
+
+inline StreamTick make_stream_tick(std::uint64_t sequence) {
+  return StreamTick{static_cast<std::uint32_t>(sequence % kStreamSymbols),
+                    static_cast<std::uint32_t>(1 + sequence % 7),
+                    100.0 + static_cast<double>(sequence % 13), sequence};
+}
+
+struct ConsumerResult {
+  double vwap = 0.0;
+  bool in_order = true;
+  StreamStats stream;
+};
+
+Task vwap_consumer(EventStream<StreamTick> stream, std::uint32_t symbol, ConsumerResult& result) {
+  double notional = 0.0;
+  std::uint64_t volume = 0;
+  std::uint64_t next_sequence = 0;
+  bool in_order = true;
+  while (const StreamTick* tick = co_await stream.next()) {
+    in_order = in_order && tick->sequence >= next_sequence; // Gaps are drops, never reordering
+    next_sequence = tick->sequence + 1;
+    if (tick->symbol == symbol) {
+      notional += tick->price * tick->size;
+      volume += tick->size;
+    }
+  }
+  result = ConsumerResult{volume ? notional / static_cast<double>(volume) : 0.0, in_order, stream.stats()};
+}
+
+struct StreamRun {
+  double seconds = 0.0;
+  StreamStats total;
+  bool in_order = true;
+  bool vwap_matches = true; // Only checked when nothing was dropped
+};
+
+// One publisher thread (this one) sends ticks in batches of publish_batch
+// to `consumers` streams of `capacity` slots each
+StreamRun run_stream_consumers(std::size_t threads, std::size_t consumers, std::size_t ticks,
+                               std::size_t capacity, std::size_t publish_batch) {
+  ThreadPool pool(threads);
+  std::vector<ConsumerResult> results(consumers);
+  StreamRun run;
+  {
+    StreamBroker<StreamTick> broker(pool);
+    for (std::size_t i = 0; i < consumers; ++i) {
+      pool.spawn(vwap_consumer(broker.stream(capacity), static_cast<std::uint32_t>(i % kStreamSymbols), results[i]));
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<StreamTick> batch;
+    for (std::uint64_t sequence = 0; sequence < ticks; ++sequence) {
+      batch.push_back(make_stream_tick(sequence));
+      if (batch.size() == publish_batch || sequence + 1 == ticks) {
+        broker.publish_batch(batch);
+        batch.clear();
+      }
+    }
+    broker.close();
+    pool.wait_idle(); // Every consumer has seen the end of its stream
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  std::vector<double> notional(kStreamSymbols, 0.0);
+  std::vector<double> volume(kStreamSymbols, 0.0);
+  for (std::uint64_t sequence = 0; sequence < ticks; ++sequence) {
+    StreamTick tick = make_stream_tick(sequence);
+    notional[tick.symbol] += tick.price * tick.size;
+    volume[tick.symbol] += tick.size;
+  }
+  for (std::size_t i = 0; i < consumers; ++i) {
+    const ConsumerResult& result = results[i];
+    run.total.delivered += result.stream.delivered;
+    run.total.batches += result.stream.batches;
+    run.total.wakeups += result.stream.wakeups;
+    run.total.dropped += result.stream.dropped;
+    run.in_order = run.in_order && result.in_order;
+    const std::size_t symbol = i % kStreamSymbols;
+    const double expected = volume[symbol] > 0 ? notional[symbol] / volume[symbol] : 0.0;
+    if (result.stream.dropped == 0 && (result.vwap - expected > 1e-9 || expected - result.vwap > 1e-9)) {
+      run.vwap_matches = false;
+    }
+  }
+  return run;
+}
+
+std::string describe_stream_run(std::size_t consumers, std::size_t ticks, const StreamRun& run) {
+  std::stringstream ss;
+  ss.setf(std::ios::fixed);
+  ss.precision(1);
+  const double delivered = static_cast<double>(run.total.delivered);
+  ss << "  " << consumers << " consumers x " << ticks << " ticks: "
+     << delivered / run.seconds / 1e6 << "M events/s, "
+     << delivered / static_cast<double>(run.total.batches ? run.total.batches : 1) << " events per batch, "
+     << static_cast<double>(run.total.wakeups) / static_cast<double>(consumers) << " wake-ups per consumer, "
+     << run.total.dropped << " dropped ("
+     << 100.0 * static_cast<double>(run.total.dropped) / static_cast<double>(consumers * ticks) << "%)"
+     << (run.in_order ? "" : ", OUT OF ORDER") << (run.vwap_matches ? "" : ", VWAP MISMATCH") << "\n";
+  return ss.str();
+}
+
+// Thousands of consumers on 4 threads; the total number of deliveries
+// stays the same as the consumer count grows
+int run_stream_benchmark() {
+  const std::size_t threads = 4;
+  const std::size_t deliveries = 4000000;
+  const std::size_t capacity = 256;
+  std::cout << "=== Coroutine stream subscribers: co_await stream.next() on " << threads << " workers ===\n"
+            << "(" << Topology::get().describe() << "), " << capacity
+            << "-slot ring per consumer, publish batches of 64; a full ring drops for that consumer only\n";
+  bool correct = true;
+  for (std::size_t consumers : {16, 256, 4096}) {
+    const std::size_t ticks = deliveries / consumers;
+    StreamRun run = run_stream_consumers(threads, consumers, ticks, capacity, 64);
+    correct = correct && run.in_order && run.vwap_matches &&
+              run.total.delivered + run.total.dropped == consumers * ticks;
+    std::cout << describe_stream_run(consumers, ticks, run) << std::flush;
+  }
+  if (!correct) {
+    std::cout << "ERROR: a consumer missed or reordered events\n";
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 1 && std::string(argv[1]) == "--bench") {
+    return run_yield_benchmark();
+  }
+  if (argc > 1 && std::string(argv[1]) == "--bench-streams") {
+    return run_stream_benchmark();
+  }
+
   ThreadPool pool(4);
 
   // Spawn a bunch of coroutine tasks
@@ -224,6 +610,26 @@ int main() {
   // Block until all tasks finish
   pool.wait_idle();
 
+  // Move tasks between pools with resume_on
+  {
+    ThreadPool io(2);
+    for (int i = 0; i < 3; ++i) {
+      pool.spawn(hopper(pool, io, i));
+    }
+    // A hopper counts towards whichever pool it is on, and is counted by the
+    // next pool before the previous one lets go: wait for each leg in turn
+    pool.wait_idle();
+    io.wait_idle();
+    pool.wait_idle();
+  }
+
+  // 1000 stateful stream consumers on the same 4 threads; the rings are
+  // as big as the run, so nothing is dropped and every VWAP must match
+  {
+    StreamRun run = run_stream_consumers(4, 1000, 1000, 1024, 50);
+    std::cout << "Stream subscribers:\n" << describe_stream_run(1000, 1000, run) << std::flush;
+  }
+
   {
     std::stringstream ss;
     ss << "All tasks done.\n";
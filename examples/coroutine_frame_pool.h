@@ -0,0 +1,220 @@
+// CoroutineFramePool: thread-local, size-class recycling of coroutine frames
+// Used by the promise types in 03, 09 and coroutine_based_thread_pool.cpp
+// Topics: promise_type::operator new, allocator_arg, size classes, thread_local caches
+//
+// Every coroutine call allocates its frame, and the compiler can rarely
+// elide that for tasks that outlive the caller. Short-lived coroutines of
+// the same few shapes then keep malloc on the hot path. Promise types that
+// derive from PooledCoroutineFrame route the frame through a per-thread
+// free list per 64-byte size class instead; as in node_arena.h, blocks only
+// cross threads in batches through a mutex-protected spill list. Once the
+// lists are warm, a coroutine costs no malloc call at all.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+
+#include "sharded_counter.h"
+
+class CoroutineFramePool {
+public:
+    static constexpr size_t kGranule = 64;
+    static constexpr size_t kClasses = 128;                  // Frames up to 8KB are pooled
+    static constexpr size_t kMaxPooled = kGranule * kClasses;
+    static constexpr uint32_t kCacheLimit = 64;              // Per class and thread, before spilling half
+
+    struct Stats {
+        uint64_t hits = 0;     // Pooled sizes served from a free list
+        uint64_t misses = 0;   // Pooled sizes that had to call operator new
+        uint64_t oversize = 0; // Larger frames, always operator new
+
+        uint64_t allocations() const { return hits + misses + oversize; }
+
+        double hit_rate() const {
+            return allocations() == 0 ? 0.0 : 100.0 * static_cast<double>(hits) / static_cast<double>(allocations());
+        }
+    };
+
+    static void* allocate(size_t bytes) {
+        Shared& s = shared();
+        if (bytes > kMaxPooled) {
+            s.oversize.add();
+            return ::operator new(bytes);
+        }
+        const size_t size_class = class_of(bytes);
+        if (void* block = take(s, size_class)) {
+            s.hits.add();
+            return block;
+        }
+        s.misses.add();
+        return ::operator new((size_class + 1) * kGranule);
+    }
+
+    static void deallocate(void* frame, size_t bytes) {
+        if (bytes > kMaxPooled) {
+            ::operator delete(frame);
+            return;
+        }
+        give(shared(), class_of(bytes), static_cast<FreeBlock*>(frame));
+    }
+
+    static Stats stats() {
+        Shared& s = shared();
+        return Stats{s.hits.load(), s.misses.load(), s.oversize.load()};
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct FreeList {
+        FreeBlock* head = nullptr;
+        uint32_t count = 0;
+
+        void push(FreeBlock* block) {
+            block->next = head;
+            head = block;
+            ++count;
+        }
+
+        FreeBlock* pop() {
+            FreeBlock* block = head;
+            if (block) {
+                head = block->next;
+                --count;
+            }
+            return block;
+        }
+
+        // Move up to n blocks onto other
+        void move_to(FreeList& other, uint32_t n) {
+            while (n-- > 0 && head) {
+                other.push(pop());
+            }
+        }
+    };
+
+    struct Shared {
+        std::mutex mutex; // Guards spill
+        FreeList spill[kClasses];
+        ShardedCounter hits;
+        ShardedCounter misses;
+        ShardedCounter oversize;
+    };
+
+    // Never destroyed: frames are still freed by threads that outlive static
+    // destruction order (e.g. event-loop workers joined from a static's dtor)
+    static Shared& shared() {
+        static Shared* instance = new Shared;
+        return *instance;
+    }
+
+    static inline thread_local bool cache_torn_down = false;
+
+    struct Cache {
+        FreeList lists[kClasses];
+
+        ~Cache() {
+            Shared& s = shared();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            for (size_t i = 0; i < kClasses; ++i) {
+                lists[i].move_to(s.spill[i], lists[i].count);
+            }
+            cache_torn_down = true;
+        }
+    };
+
+    static Cache& cache() {
+        thread_local Cache instance;
+        return instance;
+    }
+
+    static size_t class_of(size_t bytes) {
+        return bytes == 0 ? 0 : (bytes - 1) / kGranule;
+    }
+
+    static void* take(Shared& s, size_t size_class) {
+        if (cache_torn_down) {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            return s.spill[size_class].pop();
+        }
+        FreeList& local = cache().lists[size_class];
+        if (!local.head) {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.spill[size_class].move_to(local, kCacheLimit / 2);
+        }
+        return local.pop();
+    }
+
+    static void give(Shared& s, size_t size_class, FreeBlock* block) {
+        if (cache_torn_down) {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.spill[size_class].push(block);
+            return;
+        }
+        FreeList& local = cache().lists[size_class];
+        local.push(block);
+        if (local.count >= kCacheLimit) {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            local.move_to(s.spill[size_class], kCacheLimit / 2);
+        }
+    }
+};
+
+// Base for promise types. Frames come from CoroutineFramePool, or from an
+// allocator passed as the coroutine's first two arguments:
+//     Task<int> f(std::allocator_arg_t, Arena& arena, int x);
+//     f(std::allocator_arg, arena, 42);
+// where Arena has void* allocate(size_t) and void deallocate(void*, size_t).
+// operator delete only gets the frame size, so each frame ends in a
+// two-pointer trailer recording who must free it.
+struct PooledCoroutineFrame {
+    static void* operator new(size_t size) {
+        return with_trailer(CoroutineFramePool::allocate(framed(size)), size, nullptr, nullptr);
+    }
+
+    template<typename Alloc, typename... Args>
+    static void* operator new(size_t size, std::allocator_arg_t, Alloc& alloc, Args&...) {
+        auto release = [](void* context, void* frame, size_t bytes) {
+            static_cast<Alloc*>(context)->deallocate(frame, bytes);
+        };
+        return with_trailer(alloc.allocate(framed(size)), size, release, std::addressof(alloc));
+    }
+
+    static void operator delete(void* frame, size_t size) {
+        const Trailer trailer = *trailer_of(frame, size);
+        if (trailer.release) {
+            trailer.release(trailer.context, frame, framed(size));
+        } else {
+            CoroutineFramePool::deallocate(frame, framed(size));
+        }
+    }
+
+private:
+    struct Trailer {
+        void (*release)(void* context, void* frame, size_t bytes);
+        void* context;
+    };
+
+    static size_t trailer_offset(size_t size) {
+        return (size + alignof(Trailer) - 1) / alignof(Trailer) * alignof(Trailer);
+    }
+
+    static size_t framed(size_t size) {
+        return trailer_offset(size) + sizeof(Trailer);
+    }
+
+    static Trailer* trailer_of(void* frame, size_t size) {
+        return reinterpret_cast<Trailer*>(static_cast<unsigned char*>(frame) + trailer_offset(size));
+    }
+
+    static void* with_trailer(void* frame, size_t size, void (*release)(void*, void*, size_t), void* context) {
+        ::new (trailer_of(frame, size)) Trailer{release, context};
+        return frame;
+    }
+};
@@ -0,0 +1,103 @@
+// EventEnvelope: pooled, reference-counted event shared by all subscriber tasks
+// Used by the async brokers in 05 and 10 for events too big to copy per task
+// Topics: intrusive reference counting, fan-out, memory pools
+//
+// Publishing to N subscribers used to copy the event N times. With an
+// envelope the broker copies it once; every task holds an 8-byte handle and
+// the last one to finish returns the block to the NodeArena freelist, so a
+// steady stream of publishes settles at zero malloc calls. A publisher that
+// knows its fan-out takes all the task references at once (Shares).
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+#include "node_arena.h"
+
+template<typename Event>
+class EventEnvelope {
+private:
+    struct Block {
+        std::atomic<uint32_t> refs;
+        Event event;
+
+        template<typename... Args>
+        explicit Block(Args&&... args) : refs(1), event(std::forward<Args>(args)...) {}
+    };
+
+    Block* block = nullptr;
+
+    explicit EventEnvelope(Block* b) noexcept : block(b) {}
+
+    void release() noexcept {
+        // acq_rel: the last owner must see every other owner's reads finish
+        if (block && block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            NodeArena::destroy(block);
+        }
+        block = nullptr;
+    }
+
+public:
+    EventEnvelope() noexcept = default;
+
+    template<typename... Args>
+    static EventEnvelope make(Args&&... args) {
+        return EventEnvelope(NodeArena::create<Block>(std::forward<Args>(args)...));
+    }
+
+    EventEnvelope(const EventEnvelope& other) noexcept : block(other.block) {
+        if (block) {
+            block->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    EventEnvelope(EventEnvelope&& other) noexcept : block(std::exchange(other.block, nullptr)) {}
+
+    EventEnvelope& operator=(EventEnvelope other) noexcept {
+        std::swap(block, other.block);
+        return *this;
+    }
+
+    ~EventEnvelope() {
+        release();
+    }
+
+    const Event& operator*() const noexcept { return block->event; }
+    const Event* operator->() const noexcept { return &block->event; }
+
+    explicit operator bool() const noexcept { return block != nullptr; }
+
+    // Handles for a fan-out of known width: the references for all of them
+    // are added in one atomic op, so claim() is free and each task pays only
+    // for its release. Unclaimed references are returned on destruction.
+    class Shares {
+    private:
+        Block* block;
+        uint32_t left;
+
+    public:
+        Shares(const EventEnvelope& envelope, uint32_t count) noexcept
+            : block(envelope.block), left(block ? count : 0) {
+            if (left) {
+                block->refs.fetch_add(left, std::memory_order_relaxed);
+            }
+        }
+
+        Shares(const Shares&) = delete;
+        Shares& operator=(const Shares&) = delete;
+
+        ~Shares() {
+            if (left && block->refs.fetch_sub(left, std::memory_order_acq_rel) == left) {
+                NodeArena::destroy(block);
+            }
+        }
+
+        // At most count times
+        EventEnvelope claim() noexcept {
+            --left;
+            return EventEnvelope(block);
+        }
+    };
+};
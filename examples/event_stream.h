@@ -0,0 +1,425 @@
+// EventStream / StreamBroker: coroutine subscribers, co_await stream.next()
+// Used by the stream subscribers in 09 (EventLoop) and the coroutine thread pool (ThreadPool)
+// Topics: awaitable subscriptions, bounded MPSC ring per subscriber, batched drain, lost wake-ups
+//
+// The callback brokers (04, 05, 06, 08, 10) call every subscriber on some
+// thread per event: state kept across events needs a lock, and I/O per
+// event blocks the thread. Here a subscriber is a coroutine that loops over
+// its own stream, with its state in plain locals of its frame:
+//
+//     auto stream = broker.stream();
+//     while (const Tick* tick = co_await stream.next()) { ... }
+//
+// Each stream owns a bounded lock-free ring that publishers push into. A
+// consumer that finds it empty suspends; the first publish after that hands
+// it to the broker's scheduler (anything with schedule(coroutine_handle<>):
+// the EventLoop of 09, the coroutine ThreadPool). On resume it takes up to
+// max_batch events off the ring at once, so a busy stream costs one resume
+// per batch rather than per event, and an idle one costs no thread at all.
+// A full ring drops the event for that stream only and counts it: a slow
+// consumer never stalls the publisher or the other streams.
+//
+// A consumer must not be destroyed while suspended on its stream; close
+// the broker (or let it go out of scope) and let the loops finish instead.
+
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "rcu_snapshot.h"
+
+// The broker's scheduler, type-erased: resume(h) calls scheduler.schedule(h)
+struct StreamScheduler {
+    void* scheduler = nullptr;
+    void (*schedule)(void* scheduler, std::coroutine_handle<> handle) = nullptr;
+
+    template<typename Scheduler>
+    static StreamScheduler of(Scheduler& target) {
+        return StreamScheduler{&target, [](void* s, std::coroutine_handle<> handle) {
+            static_cast<Scheduler*>(s)->schedule(handle);
+        }};
+    }
+
+    void resume(std::coroutine_handle<> handle) const {
+        schedule(scheduler, handle);
+    }
+};
+
+struct StreamStats {
+    uint64_t delivered = 0; // Events handed to the consumer
+    uint64_t batches = 0;   // Refills from the ring; delivered / batches is the batching factor
+    uint64_t wakeups = 0;   // Times a publisher resumed the suspended consumer
+    uint64_t dropped = 0;   // Events lost to a full ring
+};
+
+// What a stream's publishers and its consumer share. The ring is Vyukov's
+// bounded queue with a single consumer: publishers claim a slot with a CAS
+// on tail, the consumer owns head.
+template<typename Event>
+class StreamState {
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        Event event;
+    };
+
+    const uint64_t capacity;
+    std::unique_ptr<Slot[]> slots;
+    alignas(64) std::atomic<uint64_t> tail{0};
+    alignas(64) std::atomic<uint64_t> head{0}; // Written only by the consumer
+    alignas(64) std::atomic<void*> waiter{nullptr}; // The suspended consumer, if any
+    std::atomic<bool> closed_flag{false};
+    std::atomic<bool> detached_flag{false};
+    std::atomic<uint64_t> dropped_count{0};
+    std::atomic<uint64_t> wakeup_count{0};
+    const StreamScheduler scheduler;
+
+    static uint64_t round_up(size_t n) {
+        uint64_t size = 2;
+        while (size < n) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    // Something for the consumer to do: an event, or the end of the stream
+    bool should_run() const {
+        return readable() || closed();
+    }
+
+public:
+    StreamState(size_t slot_count, StreamScheduler resumer)
+        : capacity(round_up(slot_count)), slots(new Slot[capacity]), scheduler(resumer) {
+        for (uint64_t i = 0; i < capacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Any thread. False (and counted) if the ring is full.
+    bool push(const Event& event) {
+        uint64_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[pos & (capacity - 1)];
+            const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const int64_t lag = static_cast<int64_t>(sequence - pos);
+            if (lag == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.event = event;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (lag < 0) {
+                dropped_count.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer only
+    bool pop(Event& event) {
+        const uint64_t pos = head.load(std::memory_order_relaxed);
+        Slot& slot = slots[pos & (capacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+        event = slot.event;
+        slot.sequence.store(pos + capacity, std::memory_order_release);
+        head.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Exact for the consumer; for a publisher holding the waiter, whose
+    // acquire of it makes the consumer's last head visible
+    bool readable() const {
+        const uint64_t pos = head.load(std::memory_order_relaxed);
+        return slots[pos & (capacity - 1)].sequence.load(std::memory_order_acquire) == pos + 1;
+    }
+
+    // Consumer, from await_suspend: park handle unless there is already
+    // something to do. Returns whether the coroutine stays suspended. Once
+    // handle is published a publisher may resume it on another thread, so
+    // nothing here touches the awaiter (which lives in the frame), and the
+    // caller must keep this state alive by a reference of its own.
+    bool suspend(std::coroutine_handle<> handle) {
+        waiter.store(handle.address(), std::memory_order_seq_cst);
+        // Pairs with the fence in notify(): either the publisher sees the
+        // waiter, or we see its event
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (should_run() && waiter.exchange(nullptr, std::memory_order_acq_rel) != nullptr) {
+            return false; // Still ours: resume right away
+        }
+        return true; // Either nothing to do, or a publisher took us and resumes us
+    }
+
+    // Publisher, after its pushes (or close)
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wake();
+    }
+
+    // notify() without its fence, for a publisher that pushed to many
+    // streams and then issued one seq_cst fence for all of them
+    void wake() {
+        if (waiter.load(std::memory_order_relaxed) == nullptr) {
+            return;
+        }
+        void* handle = waiter.exchange(nullptr, std::memory_order_acq_rel);
+        while (handle) {
+            if (should_run()) {
+                wakeup_count.fetch_add(1, std::memory_order_relaxed);
+                scheduler.resume(std::coroutine_handle<>::from_address(handle));
+                return;
+            }
+            // The consumer ate our event and parked again before we got
+            // here: hand the wait back, then re-check for a publish that
+            // found the waiter gone while we held it
+            waiter.store(handle, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!should_run()) {
+                return;
+            }
+            handle = waiter.exchange(nullptr, std::memory_order_acq_rel);
+        }
+    }
+
+    // Events pushed before close() are still delivered
+    void close() {
+        closed_flag.store(true, std::memory_order_release);
+        notify();
+    }
+
+    bool closed() const {
+        return closed_flag.load(std::memory_order_acquire);
+    }
+
+    // The consumer's EventStream is gone; the broker skips and prunes it
+    void detach() {
+        detached_flag.store(true, std::memory_order_release);
+    }
+
+    bool detached() const {
+        return detached_flag.load(std::memory_order_acquire);
+    }
+
+    uint64_t dropped() const {
+        return dropped_count.load(std::memory_order_relaxed);
+    }
+
+    uint64_t wakeups() const {
+        return wakeup_count.load(std::memory_order_relaxed);
+    }
+};
+
+// The consumer's end: move-only, owned by one coroutine
+template<typename Event>
+class EventStream {
+private:
+    std::shared_ptr<StreamState<Event>> state;
+    std::vector<Event> batch; // Refilled from the ring, max_batch slots
+    size_t filled = 0;
+    size_t cursor = 0;
+    uint64_t delivered = 0;
+    uint64_t batches = 0;
+
+    bool refill() {
+        cursor = 0;
+        filled = 0;
+        while (filled < batch.size() && state->pop(batch[filled])) {
+            ++filled;
+        }
+        batches += filled > 0 ? 1 : 0;
+        return filled > 0;
+    }
+
+    // Something to hand out now: buffered events, a fresh batch, or the end
+    bool ready() {
+        return cursor < filled || refill() || state->closed();
+    }
+
+    // After ready() or a resume: make cursor point at an event if there is
+    // one. False only at the end of the stream.
+    bool fill() {
+        if (cursor < filled || refill()) {
+            return true;
+        }
+        // Closed: the close happened after the last push, so one more
+        // refill sees everything that made it into the ring
+        return refill();
+    }
+
+    struct Awaiter {
+        EventStream& stream;
+
+        bool await_ready() { return stream.ready(); }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            // The coroutine may run to its end, and release the stream,
+            // before suspend() returns
+            std::shared_ptr<StreamState<Event>> keep = stream.state;
+            return keep->suspend(handle);
+        }
+    };
+
+public:
+    EventStream(std::shared_ptr<StreamState<Event>> shared, size_t max_batch)
+        : state(std::move(shared)), batch(max_batch == 0 ? 1 : max_batch) {}
+
+    EventStream(EventStream&&) noexcept = default;
+    EventStream& operator=(EventStream&& other) noexcept {
+        if (this != &other) {
+            if (state) {
+                state->detach();
+            }
+            state = std::move(other.state);
+            batch = std::move(other.batch);
+            filled = std::exchange(other.filled, 0);
+            cursor = std::exchange(other.cursor, 0);
+            delivered = other.delivered;
+            batches = other.batches;
+        }
+        return *this;
+    }
+    EventStream(const EventStream&) = delete;
+    EventStream& operator=(const EventStream&) = delete;
+
+    ~EventStream() {
+        if (state) {
+            state->detach();
+        }
+    }
+
+    // co_await next(): the next event, or nullptr once the broker has
+    // closed and everything before that has been delivered. The pointer is
+    // valid until the next call.
+    auto next() {
+        struct Next : Awaiter {
+            const Event* await_resume() {
+                if (!this->stream.fill()) {
+                    return nullptr;
+                }
+                ++this->stream.delivered;
+                return &this->stream.batch[this->stream.cursor++];
+            }
+        };
+        return Next{{*this}};
+    }
+
+    // co_await next_batch(): every event buffered so far (at most
+    // max_batch), empty at the end of the stream. Valid until the next call.
+    auto next_batch() {
+        struct NextBatch : Awaiter {
+            std::span<const Event> await_resume() {
+                EventStream& s = this->stream;
+                if (!s.fill()) {
+                    return {};
+                }
+                std::span<const Event> events(s.batch.data() + s.cursor, s.filled - s.cursor);
+                s.delivered += events.size();
+                s.cursor = s.filled;
+                return events;
+            }
+        };
+        return NextBatch{{*this}};
+    }
+
+    // A moved-from stream reports what it delivered, and no wake-ups or drops
+    StreamStats stats() const {
+        if (!state) {
+            return StreamStats{delivered, batches, 0, 0};
+        }
+        return StreamStats{delivered, batches, state->wakeups(), state->dropped()};
+    }
+};
+
+// Fan-out to every open stream. The stream list is an RcuSnapshot, so
+// publishers (any number of threads) never lock; stream() copies the list.
+template<typename Event>
+class StreamBroker {
+private:
+    using Streams = std::vector<std::shared_ptr<StreamState<Event>>>;
+
+    RcuSnapshot<Streams> streams;
+    const StreamScheduler scheduler;
+    std::atomic<bool> closed{false};
+
+public:
+    template<typename Scheduler>
+    explicit StreamBroker(Scheduler& resume_on) : scheduler(StreamScheduler::of(resume_on)) {}
+
+    ~StreamBroker() {
+        close();
+    }
+
+    StreamBroker(const StreamBroker&) = delete;
+    StreamBroker& operator=(const StreamBroker&) = delete;
+
+    // A new subscription. capacity: ring slots (rounded up to a power of
+    // two); max_batch: events taken off the ring per refill. Streams whose
+    // consumer has gone are pruned here.
+    EventStream<Event> stream(size_t capacity = 1024, size_t max_batch = 64) {
+        auto state = std::make_shared<StreamState<Event>>(capacity, scheduler);
+        streams.update([&state](Streams& list) {
+            std::erase_if(list, [](const auto& s) { return s->detached(); });
+            list.push_back(state);
+            return true;
+        });
+        // Pairs with the fence in close(): either it sees the new stream, or we see the flag
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (closed.load(std::memory_order_relaxed)) {
+            state->close(); // Raced with close(): end it right away
+        }
+        return EventStream<Event>(std::move(state), max_batch);
+    }
+
+    // Returns how many streams had to drop the event
+    size_t publish(const Event& event) {
+        return publish_batch(std::span<const Event>(&event, 1));
+    }
+
+    // Pushes to every stream, then one fence for all of them, then one
+    // wake-up check per stream; returns the events dropped
+    size_t publish_batch(std::span<const Event> events) {
+        size_t dropped = 0;
+        auto snapshot = streams.load();
+        for (const auto& stream : *snapshot) {
+            if (stream->detached()) {
+                continue;
+            }
+            for (const Event& event : events) {
+                dropped += stream->push(event) ? 0 : 1;
+            }
+        }
+        // Pairs with the fence in suspend(), as in notify()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (const auto& stream : *snapshot) {
+            if (!stream->detached()) {
+                stream->wake();
+            }
+        }
+        return dropped;
+    }
+
+    // Ends every stream: consumers see the end once they have drained what
+    // was published before. Publishing after close() is not allowed.
+    void close() {
+        closed.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto snapshot = streams.load();
+        for (const auto& stream : *snapshot) {
+            stream->close();
+        }
+    }
+
+    size_t stream_count() const {
+        return streams.load()->size();
+    }
+};
@@ -0,0 +1,96 @@
+// InlineTask: move-only, allocation-free replacement for std::function<void()>
+// Used by the thread pools in examples 01, 05 and 10
+// Topics: type erasure, small-buffer storage, static_assert
+//
+// The callable is stored in a fixed inline buffer. A capture that does not
+// fit is a compile-time error instead of a silent heap allocation, so a pool
+// that stores InlineTask never calls malloc on its submit/execute path.
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template<size_t Capacity = 64>
+class InlineTask {
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*relocate)(void* dst, void* src) noexcept; // move-construct + destroy src
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template<typename Fn>
+    static constexpr Ops ops_for{
+        [](void* storage) { (*static_cast<Fn*>(storage))(); },
+        [](void* dst, void* src) noexcept {
+            ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+            static_cast<Fn*>(src)->~Fn();
+        },
+        [](void* storage) noexcept { static_cast<Fn*>(storage)->~Fn(); }
+    };
+
+    alignas(std::max_align_t) unsigned char storage[Capacity];
+    const Ops* ops = nullptr;
+
+    void reset() noexcept {
+        if (ops) {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+
+public:
+    InlineTask() noexcept = default;
+
+    template<typename F,
+             typename Fn = std::decay_t<F>,
+             typename = std::enable_if_t<!std::is_same_v<Fn, InlineTask>>>
+    InlineTask(F&& f) {
+        static_assert(sizeof(Fn) <= Capacity,
+                      "capture does not fit in InlineTask: shrink the capture or raise Capacity");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t),
+                      "over-aligned captures are not supported by InlineTask");
+        static_assert(std::is_nothrow_move_constructible_v<Fn>,
+                      "InlineTask relocates callables and needs a noexcept move");
+        static_assert(std::is_invocable_v<Fn&>, "InlineTask needs a void() callable");
+
+        ::new (static_cast<void*>(storage)) Fn(std::forward<F>(f));
+        ops = &ops_for<Fn>;
+    }
+
+    InlineTask(InlineTask&& other) noexcept : ops(other.ops) {
+        if (ops) {
+            ops->relocate(storage, other.storage);
+            other.ops = nullptr;
+        }
+    }
+
+    InlineTask& operator=(InlineTask&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other.ops) {
+                other.ops->relocate(storage, other.storage);
+                ops = std::exchange(other.ops, nullptr);
+            }
+        }
+        return *this;
+    }
+
+    InlineTask(const InlineTask&) = delete;
+    InlineTask& operator=(const InlineTask&) = delete;
+
+    ~InlineTask() {
+        reset();
+    }
+
+    void operator()() {
+        ops->invoke(storage);
+    }
+
+    explicit operator bool() const noexcept {
+        return ops != nullptr;
+    }
+};
@@ -0,0 +1,213 @@
+// LatencyHistogram / LatencyRecorder: HDR-style latency histograms
+// Used by the thread pool and HighPerfEventBroker in 10
+// Topics: log-linear bucketing, per-thread recording, on-demand merging
+//
+// Buckets are log-linear: every power of two is split into 32 equal
+// sub-buckets, so any value is stored within ~3% of itself from nanoseconds
+// up to hours, in a fixed 15KB table. Recording is a clock read, a bit scan
+// and one increment of the calling thread's own table (plain relaxed load and
+// store, no read-modify-write, no shared cache line). Readers merge the
+// per-thread tables into a LatencyHistogram whenever they want a report.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "thread_slot_cache.h"
+
+// Nanoseconds on the steady clock (a vDSO call on Linux, no syscall)
+inline uint64_t latency_now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Index of the highest set bit; value must be non-zero
+inline size_t highest_bit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - static_cast<size_t>(__builtin_clzll(value));
+#else
+    size_t bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+class LatencyHistogram {
+public:
+    static constexpr size_t kSubBucketBits = 5;
+    static constexpr size_t kSubBuckets = size_t{1} << kSubBucketBits;
+    // Values below 2 * kSubBuckets are exact; each later power of two gets kSubBuckets
+    static constexpr size_t kBuckets = 2 * kSubBuckets + (64 - kSubBucketBits - 1) * kSubBuckets;
+
+    static size_t bucket_of(uint64_t value) {
+        if (value < 2 * kSubBuckets) {
+            return static_cast<size_t>(value);
+        }
+        const size_t msb = highest_bit(value);
+        const size_t shift = msb - kSubBucketBits;
+        const size_t sub = static_cast<size_t>(value >> shift) - kSubBuckets;
+        return 2 * kSubBuckets + (msb - kSubBucketBits - 1) * kSubBuckets + sub;
+    }
+
+    // Midpoint of the values that land in bucket index
+    static uint64_t bucket_value(size_t index) {
+        if (index < 2 * kSubBuckets) {
+            return index;
+        }
+        const size_t group = (index - 2 * kSubBuckets) / kSubBuckets;
+        const size_t sub = (index - 2 * kSubBuckets) % kSubBuckets;
+        const size_t shift = group + 1;
+        return ((kSubBuckets + sub) << shift) + (uint64_t{1} << shift) / 2;
+    }
+
+    void record(uint64_t value, uint64_t n = 1) {
+        counts[bucket_of(value)] += n;
+        total += n;
+        sum += value * n;
+        max_value = std::max(max_value, value);
+    }
+
+    // Bucket-wise add, e.g. of per-thread histograms
+    void add(size_t bucket, uint64_t n) {
+        counts[bucket] += n;
+        total += n;
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < kBuckets; ++i) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+        sum += other.sum;
+        max_value = std::max(max_value, other.max_value);
+    }
+
+    void add_totals(uint64_t value_sum, uint64_t value_max) {
+        sum += value_sum;
+        max_value = std::max(max_value, value_max);
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return max_value; }
+
+    double mean() const {
+        return total == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(total);
+    }
+
+    // p in [0, 100]; 0 when empty. Never reports more than the recorded max.
+    uint64_t percentile(double p) const {
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::min(bucket_value(i), max_value);
+            }
+        }
+        return max_value;
+    }
+
+    // "p50 1.2us  p90 ...  p99 ...  p99.9 ...  max ...  (n samples)"
+    std::string summary() const {
+        auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+        std::stringstream ss;
+        ss.setf(std::ios::fixed);
+        ss.precision(1);
+        ss << "p50 " << us(percentile(50)) << "us  p90 " << us(percentile(90))
+           << "us  p99 " << us(percentile(99)) << "us  p99.9 " << us(percentile(99.9))
+           << "us  max " << us(max()) << "us  (" << count() << " samples)";
+        return ss.str();
+    }
+
+private:
+    std::array<uint64_t, kBuckets> counts{};
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t max_value = 0;
+};
+
+// One histogram per recording thread, merged by snapshot(). Each thread
+// finds its own table through a ThreadSlotCache (thread_slot_cache.h), so
+// record() never touches memory another thread writes to.
+class LatencyRecorder {
+private:
+    struct alignas(64) Table {
+        // Single writer: relaxed load + store instead of fetch_add
+        std::atomic<uint64_t> counts[LatencyHistogram::kBuckets] = {};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+        uint64_t thread = 0; // this_thread_token() of the writer
+
+        static void bump(std::atomic<uint64_t>& counter, uint64_t by) {
+            counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+        }
+    };
+
+    mutable std::mutex mutex; // Guards tables (registration and snapshot only)
+    std::vector<std::unique_ptr<Table>> tables;
+    const uint64_t recorder_id;
+
+    Table& local_table() {
+        return ThreadSlotCache<Table>::get(recorder_id, [this]() -> Table& {
+            const uint64_t thread = this_thread_token();
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto& table : tables) {
+                if (table->thread == thread) {
+                    return *table;
+                }
+            }
+            tables.push_back(std::make_unique<Table>());
+            tables.back()->thread = thread;
+            return *tables.back();
+        });
+    }
+
+public:
+    LatencyRecorder() : recorder_id(next_slot_owner_id()) {}
+
+    LatencyRecorder(const LatencyRecorder&) = delete;
+    LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+
+    void record(uint64_t nanoseconds) {
+        Table& table = local_table();
+        Table::bump(table.counts[LatencyHistogram::bucket_of(nanoseconds)], 1);
+        Table::bump(table.sum, nanoseconds);
+        if (nanoseconds > table.max.load(std::memory_order_relaxed)) {
+            table.max.store(nanoseconds, std::memory_order_relaxed);
+        }
+    }
+
+    // Merge of every thread's table so far; concurrent recording may or may
+    // not be included, but nothing is ever counted twice
+    LatencyHistogram snapshot() const {
+        LatencyHistogram merged;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& table : tables) {
+            for (size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+                uint64_t n = table->counts[i].load(std::memory_order_relaxed);
+                if (n != 0) {
+                    merged.add(i, n);
+                }
+            }
+            merged.add_totals(table->sum.load(std::memory_order_relaxed),
+                              table->max.load(std::memory_order_relaxed));
+        }
+        return merged;
+    }
+};
@@ -0,0 +1,224 @@
+// NodeArena: per-thread, cache-line-aligned freelist for fixed-size nodes
+// Used by LockFreeQueue (02) and the RCU subscriber lists (06, 10)
+// Topics: thread_local caches, false sharing, allocator policies
+//
+// Node-based lock-free structures allocate on every insert. With plain
+// new/delete that puts malloc (and its internal locks) on the hot path.
+// Here each thread recycles blocks through a private cache; only batches of
+// blocks ever cross threads, through a mutex-protected spill list. Blocks are
+// rounded up to whole cache lines so two nodes never share one. The lists are
+// intrusive, so freeing a node (or a shared_ptr control block) cannot throw.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+constexpr size_t kCacheLineSize = 64;
+
+// All blocks of one size class. Free blocks are linked through their own
+// first word, so freeing never allocates and never throws.
+template<size_t BlockSize>
+class FixedBlockPool {
+private:
+    static constexpr size_t kBlockBytes =
+        (BlockSize + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+    static constexpr size_t kBlocksPerChunk = 64;
+    static constexpr size_t kCacheSize = 256; // Per thread, before spilling half
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct FreeList {
+        FreeBlock* head = nullptr;
+        size_t count = 0;
+
+        void push(void* block) noexcept {
+            auto* node = static_cast<FreeBlock*>(block);
+            node->next = head;
+            head = node;
+            ++count;
+        }
+
+        void* pop() noexcept {
+            FreeBlock* block = head;
+            if (block) {
+                head = block->next;
+                --count;
+            }
+            return block;
+        }
+
+        // Move up to n blocks onto other
+        void move_to(FreeList& other, size_t n) noexcept {
+            while (n-- > 0 && head) {
+                other.push(pop());
+            }
+        }
+    };
+
+    struct Shared {
+        std::mutex mutex;
+        FreeList spill;
+        std::vector<void*> chunks;
+
+        ~Shared() {
+            for (void* chunk : chunks) {
+                ::operator delete(chunk, std::align_val_t(kCacheLineSize));
+            }
+        }
+    };
+
+    static Shared& shared() {
+        static Shared instance;
+        return instance;
+    }
+
+    // Set once this thread's cache is gone; blocks freed later during thread
+    // exit (e.g. by a reclaimer flushing its retired list) go to the spill list
+    static inline thread_local bool cache_torn_down = false;
+
+    struct Cache {
+        FreeList blocks;
+
+        ~Cache() {
+            Shared& s = shared();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            blocks.move_to(s.spill, blocks.count);
+            cache_torn_down = true;
+        }
+    };
+
+    static Cache& cache() {
+        thread_local Cache instance;
+        return instance;
+    }
+
+    // Called with the shared mutex held
+    static void* carve_chunk(Shared& s, FreeList& into) {
+        s.chunks.reserve(s.chunks.size() + 1); // Throws before the chunk exists, not after
+        auto* chunk = static_cast<unsigned char*>(
+            ::operator new(kBlockBytes * kBlocksPerChunk, std::align_val_t(kCacheLineSize)));
+        s.chunks.push_back(chunk);
+        for (size_t i = 1; i < kBlocksPerChunk; ++i) {
+            into.push(chunk + i * kBlockBytes);
+        }
+        return chunk;
+    }
+
+public:
+    static void* allocate() {
+        if (cache_torn_down) {
+            Shared& s = shared();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if (void* block = s.spill.pop()) {
+                return block;
+            }
+            return carve_chunk(s, s.spill);
+        }
+
+        FreeList& local = cache().blocks;
+        if (!local.head) {
+            Shared& s = shared();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if (!s.spill.head) {
+                return carve_chunk(s, local);
+            }
+            s.spill.move_to(local, kCacheSize / 2);
+        }
+        return local.pop();
+    }
+
+    static void deallocate(void* block) noexcept {
+        if (cache_torn_down) {
+            Shared& s = shared();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.spill.push(block);
+            return;
+        }
+
+        FreeList& local = cache().blocks;
+        local.push(block);
+        if (local.count >= kCacheSize) {
+            Shared& s = shared();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            local.move_to(s.spill, kCacheSize / 2);
+        }
+    }
+
+    // Blocks obtained from operator new so far (in chunks)
+    static size_t reserved() {
+        Shared& s = shared();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.chunks.size() * kBlocksPerChunk;
+    }
+};
+
+// Allocator policies for node-based containers:
+//   Node* p = A::template create<Node>(args...);
+//   A::destroy(p);
+struct NodeArena {
+    template<typename Node, typename... Args>
+    static Node* create(Args&&... args) {
+        static_assert(alignof(Node) <= kCacheLineSize, "NodeArena blocks are cache-line aligned");
+        return ::new (FixedBlockPool<sizeof(Node)>::allocate()) Node(std::forward<Args>(args)...);
+    }
+
+    template<typename Node>
+    static void destroy(Node* node) {
+        node->~Node();
+        FixedBlockPool<sizeof(Node)>::deallocate(node);
+    }
+};
+
+// Baseline: plain new/delete
+struct HeapAllocator {
+    template<typename Node, typename... Args>
+    static Node* create(Args&&... args) {
+        return new Node(std::forward<Args>(args)...);
+    }
+
+    template<typename Node>
+    static void destroy(Node* node) {
+        delete node;
+    }
+};
+
+// Standard allocator over the same pools, for std::allocate_shared: the
+// shared_ptr control block and the node then come from one arena block
+template<typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() noexcept = default;
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        static_assert(alignof(T) <= kCacheLineSize, "ArenaAllocator blocks are cache-line aligned");
+        if (n == 1) {
+            return static_cast<T*>(FixedBlockPool<sizeof(T)>::allocate());
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        if (n == 1) {
+            FixedBlockPool<sizeof(T)>::deallocate(p);
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>&) const noexcept { return true; }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>&) const noexcept { return false; }
+};
@@ -0,0 +1,75 @@
+// RcuSnapshot: copy-on-write, atomically published immutable value
+// The subscriber-list mechanism of example 06, shared with the brokers in 05, 08 and 10
+// Topics: RCU, std::atomic<std::shared_ptr>, copy-on-write
+//
+// Readers load the current snapshot (one atomic shared_ptr load) and use it
+// for as long as they like; it stays alive while they hold it. Writers copy
+// the snapshot, edit the copy and publish it with CAS, retrying if another
+// writer got there first. Readers never wait for writers and never copy.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+// std::atomic<std::shared_ptr> is C++20; before that, the same operations
+// are available as free functions on a plain shared_ptr
+#if defined(__cpp_lib_atomic_shared_ptr)
+template<typename T>
+using AtomicSharedPtr = std::atomic<std::shared_ptr<T>>;
+#else
+template<typename T>
+class AtomicSharedPtr {
+private:
+    std::shared_ptr<T> ptr;
+
+public:
+    explicit AtomicSharedPtr(std::shared_ptr<T> initial) : ptr(std::move(initial)) {}
+
+    std::shared_ptr<T> load(std::memory_order order) const {
+        return std::atomic_load_explicit(&ptr, order);
+    }
+
+    bool compare_exchange_weak(std::shared_ptr<T>& expected, std::shared_ptr<T> desired,
+                               std::memory_order success, std::memory_order failure) {
+        return std::atomic_compare_exchange_weak_explicit(
+            &ptr, &expected, std::move(desired), success, failure);
+    }
+};
+#endif
+
+// Snapshots and their control blocks come from Allocator (rebound)
+template<typename T, typename Allocator = std::allocator<T>>
+class RcuSnapshot {
+private:
+    using SnapshotAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+    AtomicSharedPtr<const T> current;
+
+public:
+    RcuSnapshot() : current(std::allocate_shared<T>(SnapshotAllocator())) {}
+
+    std::shared_ptr<const T> load() const {
+        return current.load(std::memory_order_acquire);
+    }
+
+    // edit changes a private copy and returns false to keep the current
+    // snapshot. Retried (on a fresh copy) if another writer got in first.
+    template<typename Edit>
+    bool update(Edit&& edit) {
+        auto snapshot = load();
+        while (true) {
+            auto next = std::allocate_shared<T>(SnapshotAllocator(), *snapshot);
+            if (!edit(*next)) {
+                return false;
+            }
+            std::shared_ptr<const T> desired = std::move(next);
+            if (current.compare_exchange_weak(snapshot, desired,
+                                              std::memory_order_release,
+                                              std::memory_order_acquire)) {
+                return true;
+            }
+        }
+    }
+};
@@ -0,0 +1,42 @@
+# Unified benchmark driver, run by the bench_all target:
+#   cmake -DBENCH_EXAMPLES=<exe>|<exe>... -DBENCH_OUTPUT=<file> -P run_benchmarks.cmake
+# Runs every example's --bench-json mode (see bench_harness.h) over the same
+# workload matrix and collects all records into one JSON array in
+# BENCH_OUTPUT. Keep the file from an earlier run to diff against.
+
+if(NOT BENCH_EXAMPLES OR NOT BENCH_OUTPUT)
+    message(FATAL_ERROR "usage: cmake -DBENCH_EXAMPLES=a|b -DBENCH_OUTPUT=file -P run_benchmarks.cmake")
+endif()
+string(REPLACE "|" ";" examples "${BENCH_EXAMPLES}")
+
+# One line per workload; the examples apply the knobs that fit them
+set(workloads
+    "--producers=1 --consumers=4 --subscribers=4 --event-bytes=64 --task-ns=0"
+    "--producers=4 --consumers=4 --subscribers=4 --event-bytes=64 --task-ns=0"
+    "--producers=1 --consumers=4 --subscribers=16 --event-bytes=256 --task-ns=0"
+    "--producers=2 --consumers=4 --subscribers=4 --event-bytes=1024 --task-ns=1000"
+)
+set(common "--ops=50000 --trials=3")
+
+set(records "${BENCH_OUTPUT}.jsonl")
+file(REMOVE "${records}")
+foreach(example IN LISTS examples)
+    get_filename_component(name "${example}" NAME)
+    foreach(workload IN LISTS workloads)
+        message(STATUS "${name} ${workload}")
+        separate_arguments(args UNIX_COMMAND "${common} ${workload}")
+        execute_process(COMMAND "${example}" --bench-json ${args} "--out=${records}"
+                        OUTPUT_QUIET
+                        RESULT_VARIABLE result)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "${name} --bench-json failed (${result})")
+        endif()
+    endforeach()
+endforeach()
+
+file(STRINGS "${records}" lines)
+list(JOIN lines ",\n  " body)
+file(WRITE "${BENCH_OUTPUT}" "[\n  ${body}\n]\n")
+file(REMOVE "${records}")
+list(LENGTH lines count)
+message(STATUS "Wrote ${count} records to ${BENCH_OUTPUT}")
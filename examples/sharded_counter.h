@@ -0,0 +1,89 @@
+// ShardedCounter: statistics counter split into cache-line-padded slots
+// Used by the brokers in 10 and the publish benchmarks in 05 and 08; benchmarked in 07
+// Topics: false sharing, cache-line contention, aggregate-on-read
+//
+// A single std::atomic counter bumped by every worker is one cache line that
+// all cores fight over: each fetch_add has to pull the line over in exclusive
+// state. Here every thread adds into its own slot, and load() sums the slots.
+// A thread claims the lowest free slot the first time it counts and frees it
+// when it exits, so pools and benchmark runs that come and go keep reusing
+// the same slots.
+// Writes stay core-local; reads get slower, which suits counters that are
+// written per event and read for a stats line.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class ShardedCounter {
+public:
+    static constexpr size_t kSlots = 64;
+
+    // Relaxed: a statistic, not a synchronisation point. Live threads share a
+    // slot only when more than kSlots of them count, so the RMW is uncontended.
+    void add(uint64_t n = 1) {
+        slots[this_thread_slot()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    // Sum over all slots. Not a snapshot: concurrent adds may or may not be
+    // included, but none is ever lost once its thread has synchronised with
+    // the reader (e.g. through a join or a pool drain).
+    uint64_t load() const {
+        uint64_t total = 0;
+        for (const Slot& slot : slots) {
+            total += slot.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> value{0};
+    };
+
+    Slot slots[kSlots];
+
+    // Slot numbers are shared by every counter; bit i is set while a live
+    // thread holds slot i. Beyond kSlots live threads, the rest are spread
+    // round-robin over all slots.
+    static_assert(kSlots == 64, "one bit of slots_in_use per slot");
+    static inline std::atomic<uint64_t> slots_in_use{0};
+    static inline std::atomic<size_t> overflow_slot{0};
+
+    struct SlotClaim {
+        size_t slot;
+        bool owned = false;
+
+        SlotClaim() {
+            uint64_t used = slots_in_use.load(std::memory_order_relaxed);
+            while (used != ~uint64_t{0}) {
+                size_t lowest = 0;
+                while ((used >> lowest) & 1) {
+                    ++lowest;
+                }
+                if (slots_in_use.compare_exchange_weak(used, used | (uint64_t{1} << lowest),
+                                                       std::memory_order_relaxed)) {
+                    slot = lowest;
+                    owned = true;
+                    return;
+                }
+            }
+            slot = overflow_slot.fetch_add(1, std::memory_order_relaxed) % kSlots;
+        }
+
+        // A count made later in the thread's exit (another thread_local's
+        // destructor) still lands in the slot: shared at worst, never lost
+        ~SlotClaim() {
+            if (owned) {
+                slots_in_use.fetch_and(~(uint64_t{1} << slot), std::memory_order_relaxed);
+            }
+        }
+    };
+
+    static size_t this_thread_slot() {
+        thread_local SlotClaim claim;
+        return claim.slot;
+    }
+};
@@ -0,0 +1,73 @@
+// SymbolTable: interns symbol names to dense integer ids
+// Used by the fixed-size events in 05 and 10 and the keyed broker in 10
+// Topics: string interning, read-mostly locking
+//
+// Hot paths should carry the SymbolId, not the string: comparing and hashing
+// a uint32_t is free, and copying it never allocates. intern() takes an
+// exclusive lock only the first time a name is seen; lookups share the lock.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using SymbolId = uint32_t;
+
+class SymbolTable {
+private:
+    mutable std::shared_mutex mutex;
+    std::deque<std::string> names; // Indexed by id; deque keeps references stable
+    std::unordered_map<std::string_view, SymbolId> ids; // Views into names
+
+public:
+    SymbolId intern(std::string_view name) {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto it = ids.find(name);
+            if (it != ids.end()) {
+                return it->second;
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(name); // Someone may have interned it meanwhile
+        if (it != ids.end()) {
+            return it->second;
+        }
+        auto id = static_cast<SymbolId>(names.size());
+        names.emplace_back(name);
+        ids.emplace(names.back(), id);
+        return id;
+    }
+
+    // Returns false if name was never interned
+    bool find(std::string_view name, SymbolId& id) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(name);
+        if (it == ids.end()) {
+            return false;
+        }
+        id = it->second;
+        return true;
+    }
+
+    // The reference stays valid for the table's lifetime
+    const std::string& name(SymbolId id) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        if (id >= names.size()) {
+            throw std::runtime_error("SymbolTable: unknown symbol id");
+        }
+        return names[id];
+    }
+
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return names.size();
+    }
+};
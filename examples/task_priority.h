@@ -0,0 +1,93 @@
+// TaskPriority / LaneSelector: priority lanes for the thread pools
+// Used by the pools in 01, 05 and 10, and the brokers built on them
+// Topics: priority classes, strict vs weighted round-robin, starvation
+//
+// With one FIFO per pool, a latency-critical risk check queues behind
+// whatever bulk work (logging, persistence) was submitted before it. The
+// pools keep one lane per TaskPriority instead, and a worker picks the lane
+// to serve next through a LaneSelector:
+//   - Strict: always the highest non-empty lane. Critical never waits for
+//     lower lanes, but a steady stream of it starves them.
+//   - Weighted: per round, up to weights[lane] tasks from each lane, highest
+//     lane first. Empty lanes give up their turn, so no worker idles while
+//     any lane has work, and every lane is guaranteed its share.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Highest first
+enum class TaskPriority : uint8_t {
+    Critical, // Decisions on the hot path: risk checks, order routing
+    Normal,   // Default for submit() / subscribe()
+    Bulk      // Background work: logging, persistence, analytics
+};
+
+constexpr size_t kPriorityLanes = 3;
+
+constexpr size_t lane_of(TaskPriority priority) {
+    return static_cast<size_t>(priority);
+}
+
+inline const char* priority_name(TaskPriority priority) {
+    switch (priority) {
+    case TaskPriority::Critical: return "critical";
+    case TaskPriority::Normal: return "normal";
+    case TaskPriority::Bulk: return "bulk";
+    }
+    return "?";
+}
+
+enum class LaneOrder {
+    Strict,  // Highest non-empty lane first
+    Weighted // Weighted round-robin over the lanes
+};
+
+struct LanePolicy {
+    LaneOrder order = LaneOrder::Strict;
+    std::array<uint32_t, kPriorityLanes> weights{8, 4, 1}; // Weighted: tasks per round and lane
+};
+
+// Which lane to take the next task from. Not thread-safe: one per worker,
+// or guarded by the pool's queue lock.
+class LaneSelector {
+private:
+    LanePolicy policy;
+    std::array<uint32_t, kPriorityLanes> credits;
+
+public:
+    explicit LaneSelector(const LanePolicy& lanes = {}) : policy(lanes) {
+        for (uint32_t& weight : policy.weights) {
+            weight = std::max<uint32_t>(weight, 1); // A zero weight would starve the lane for good
+        }
+        credits = policy.weights;
+    }
+
+    // Calls take(lane) in service order until one returns true (it took a
+    // task from that lane). Returns false if every lane was empty.
+    template<typename Take>
+    bool next(Take&& take) {
+        if (policy.order == LaneOrder::Strict) {
+            for (size_t lane = 0; lane < kPriorityLanes; ++lane) {
+                if (take(lane)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        for (int pass = 0; pass < 2; ++pass) {
+            for (size_t lane = 0; lane < kPriorityLanes; ++lane) {
+                if (credits[lane] > 0 && take(lane)) {
+                    --credits[lane];
+                    return true;
+                }
+            }
+            // Every lane with credit left is empty: start the next round
+            credits = policy.weights;
+        }
+        return false;
+    }
+};
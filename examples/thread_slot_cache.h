@@ -0,0 +1,61 @@
+// ThreadSlotCache: per-thread lookup of the calling thread's slot in an object
+// Used by LatencyRecorder (latency_histogram.h) and the EventJournal in 10
+// Topics: thread_local caches, object ids, bounded memory
+//
+// Per-thread state that belongs to one object (a recorder's histogram, a
+// journal's staging ring) can't live in a plain thread_local: there are many
+// objects, and they come and go while threads keep running. A thread_local
+// list of (object, slot) pairs works, but only grows -- every object a thread
+// ever touched stays in it, lookups scan the dead ones, and the pointers
+// dangle once the object is gone.
+//
+// Here each thread keeps a small direct-mapped cache instead, indexed by the
+// object's id. Ids come from one process-wide counter and are never reused,
+// so an entry left behind by a destroyed object can never match: it is just
+// overwritten by the next object that maps to the same way. A miss asks the
+// object itself (which keeps its slots keyed by this_thread_token()), so the
+// cache only has to be fast, not complete.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Unique per object for the life of the process; never 0
+inline uint64_t next_slot_owner_id() {
+    static std::atomic<uint64_t> counter{0};
+    return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+// Unique per thread for the life of the process (std::thread::id values are
+// reused once a thread exits; these are not)
+inline uint64_t this_thread_token() {
+    static std::atomic<uint64_t> counter{0};
+    thread_local uint64_t token = counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    return token;
+}
+
+template<typename Slot, size_t Ways = 16>
+class ThreadSlotCache {
+public:
+    // The calling thread's slot of owner; miss() returns it (Slot&) when the
+    // cache does not have it, and must stay valid while owner lives
+    template<typename Miss>
+    static Slot& get(uint64_t owner, Miss&& miss) {
+        thread_local std::array<Entry, Ways> entries{};
+        Entry& entry = entries[owner % Ways];
+        if (entry.owner != owner) {
+            entry.slot = &miss();
+            entry.owner = owner;
+        }
+        return *entry.slot;
+    }
+
+private:
+    struct Entry {
+        uint64_t owner = 0;
+        Slot* slot = nullptr;
+    };
+};
@@ -0,0 +1,251 @@
+// Topology: CPU / NUMA node discovery and worker pinning for the thread pools
+// Used by the pools in 01, 05, 10 and coroutine_based_thread_pool.cpp
+// Topics: CPU affinity, NUMA nodes, first-touch placement, SMT siblings
+//
+// An unpinned worker can be migrated by the scheduler at any time, leaving
+// its warm cache lines (and the padding that keeps them apart) on another
+// core. On multi-socket machines it may also end up a node away from the
+// queues it polls. Topology reads the machine layout once (sysfs on Linux,
+// limited to the CPUs the process may run on); plan_workers() spreads a
+// pool's workers over it, one block of workers per node, and
+// apply_placement() pins the calling thread. Pools apply the placement on
+// the worker thread itself before it allocates its queues: Linux places a
+// page on the node of the thread that first writes it.
+//
+// Elsewhere (macOS has no hard affinity API) everything is reported as one
+// node and pinning is a no-op.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#  include <pthread.h>
+#  include <sched.h>
+#  define HAS_THREAD_AFFINITY 1
+#else
+#  define HAS_THREAD_AFFINITY 0
+#endif
+
+// How a pool places its worker threads
+enum class ThreadPinning {
+    None, // Let the OS place and migrate workers
+    Core, // Each worker pinned to one CPU: distinct physical cores first, then SMT siblings
+    Node  // Workers grouped per NUMA node, free to move between that node's CPUs
+};
+
+// Where one worker runs. cpu is -1 unless pinned to a single CPU.
+struct WorkerPlacement {
+    int cpu = -1;
+    size_t node = 0;
+};
+
+class Topology {
+public:
+    // Discovered on first use, from the CPUs the process may run on then
+    static const Topology& get() {
+        static const Topology instance;
+        return instance;
+    }
+
+    size_t cpu_count() const {
+        size_t total = 0;
+        for (const auto& node : nodes) {
+            total += node.size();
+        }
+        return total;
+    }
+
+    size_t node_count() const {
+        return nodes.size();
+    }
+
+    // A node's CPUs, one per physical core first, then the SMT siblings
+    const std::vector<int>& cpus_of_node(size_t node) const {
+        return nodes[node];
+    }
+
+    size_t node_of_cpu(int cpu) const {
+        for (size_t n = 0; n < nodes.size(); ++n) {
+            if (std::find(nodes[n].begin(), nodes[n].end(), cpu) != nodes[n].end()) {
+                return n;
+            }
+        }
+        return 0;
+    }
+
+    // Node the calling thread is running on right now (0 if unknown)
+    size_t current_node() const {
+#if HAS_THREAD_AFFINITY
+        int cpu = sched_getcpu();
+        if (cpu >= 0 && nodes.size() > 1) {
+            return node_of_cpu(cpu);
+        }
+#endif
+        return 0;
+    }
+
+    // "2 nodes, 16 CPUs (node 0: 8 CPUs, node 1: 8 CPUs)"
+    std::string describe() const {
+        auto cpus = [](size_t n) { return std::to_string(n) + (n == 1 ? " CPU" : " CPUs"); };
+        std::stringstream ss;
+        ss << nodes.size() << (nodes.size() == 1 ? " node, " : " nodes, ") << cpus(cpu_count()) << " (";
+        for (size_t n = 0; n < nodes.size(); ++n) {
+            ss << (n ? ", " : "") << "node " << n << ": " << cpus(nodes[n].size());
+        }
+        ss << ")";
+        return ss.str();
+    }
+
+private:
+    std::vector<std::vector<int>> nodes; // Dense node index -> allowed CPUs
+
+    Topology() {
+#if HAS_THREAD_AFFINITY
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+            auto is_allowed = [&allowed](int cpu) { return cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed); };
+            for (int node = 0; node < 1024; ++node) {
+                std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                if (!file) {
+                    continue; // Node ids may have gaps
+                }
+                std::string list;
+                std::getline(file, list);
+                std::vector<int> cpus;
+                for (int cpu : parse_cpu_list(list)) {
+                    if (is_allowed(cpu)) {
+                        cpus.push_back(cpu);
+                    }
+                }
+                if (!cpus.empty()) {
+                    nodes.push_back(cores_first(cpus));
+                }
+            }
+            if (nodes.empty()) {
+                // No NUMA information (e.g. a container without sysfs): one node
+                std::vector<int> cpus;
+                for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                    if (is_allowed(cpu)) {
+                        cpus.push_back(cpu);
+                    }
+                }
+                nodes.push_back(cores_first(cpus));
+            }
+        }
+#endif
+        if (nodes.empty()) {
+            std::vector<int> cpus;
+            for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+                cpus.push_back(static_cast<int>(cpu));
+            }
+            nodes.push_back(cpus);
+        }
+    }
+
+    // "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}
+    static std::vector<int> parse_cpu_list(const std::string& list) {
+        std::vector<int> cpus;
+        std::stringstream ss(list);
+        std::string range;
+        while (std::getline(ss, range, ',')) {
+            if (range.empty()) {
+                continue;
+            }
+            size_t dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+
+    // Reorder so the first CPU of every physical core comes before any
+    // SMT sibling: pinning n < cores workers then never shares a core
+    static std::vector<int> cores_first(const std::vector<int>& cpus) {
+        std::vector<std::string> seen_cores;
+        std::vector<int> primary;
+        std::vector<int> siblings;
+        for (int cpu : cpus) {
+            std::string core = read_topology(cpu, "physical_package_id") + ":" + read_topology(cpu, "core_id");
+            if (std::find(seen_cores.begin(), seen_cores.end(), core) == seen_cores.end()) {
+                seen_cores.push_back(core);
+                primary.push_back(cpu);
+            } else {
+                siblings.push_back(cpu);
+            }
+        }
+        primary.insert(primary.end(), siblings.begin(), siblings.end());
+        return primary;
+    }
+
+    static std::string read_topology(int cpu, const char* field) {
+        std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + field);
+        std::string value;
+        if (!(file >> value)) {
+            value = std::to_string(cpu); // Unknown: treat every CPU as its own core
+        }
+        return value;
+    }
+};
+
+// Placement of each of a pool's workers. Workers are split between nodes
+// in proportion to their CPU count, as consecutive blocks (so worker i and
+// i + 1 are usually neighbours); with ThreadPinning::None everything is
+// one group on node 0.
+inline std::vector<WorkerPlacement> plan_workers(size_t workers, ThreadPinning pinning) {
+    std::vector<WorkerPlacement> plan(workers);
+    if (pinning == ThreadPinning::None) {
+        return plan;
+    }
+    const Topology& topology = Topology::get();
+    const size_t total = topology.cpu_count();
+    std::vector<size_t> used(topology.node_count(), 0);
+    for (size_t i = 0; i < workers; ++i) {
+        // Centre of worker i's share of the CPU list, mapped back to a node
+        size_t position = (2 * i + 1) * total / (2 * workers);
+        size_t node = 0;
+        while (position >= topology.cpus_of_node(node).size()) {
+            position -= topology.cpus_of_node(node).size();
+            ++node;
+        }
+        plan[i].node = node;
+        if (pinning == ThreadPinning::Core) {
+            const auto& cpus = topology.cpus_of_node(node);
+            plan[i].cpu = cpus[used[node]++ % cpus.size()];
+        }
+    }
+    return plan;
+}
+
+// Pin the calling thread. Returns false if the platform or the kernel
+// refused; the thread then simply stays unpinned.
+inline bool apply_placement(const WorkerPlacement& placement, ThreadPinning pinning) {
+    if (pinning == ThreadPinning::None) {
+        return true;
+    }
+#if HAS_THREAD_AFFINITY
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pinning == ThreadPinning::Core && placement.cpu >= 0) {
+        CPU_SET(placement.cpu, &set);
+    } else {
+        for (int cpu : Topology::get().cpus_of_node(placement.node)) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)placement;
+    return false;
+#endif
+}
@@ -0,0 +1,81 @@
+// WorkStealingDeque: bounded FIFO work-stealing queue for task handles
+// Used by the coroutine event loop in 09 and the ThreadPool in
+// coroutine_based_thread_pool.cpp
+// Topics: work stealing, memory ordering, FIFO vs LIFO scheduling
+//
+// One owner thread pushes; the owner and any number of thieves take from the
+// other end with a CAS, so work leaves in arrival order and an idle thread
+// can help a busy one without a lock.
+//
+// This is the steal half of a Chase-Lev deque only. A Chase-Lev owner pops
+// its newest item at the bottom, paying a CAS only when racing for the last
+// one, but that order is LIFO: a coroutine that yields would be popped right
+// back ahead of everything queued behind it. Here the owner takes the oldest
+// item through steal() like everyone else, so a yield really lets the others
+// run -- at the price of a seq_cst fence and a CAS on top for every take.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Work-stealing queue (bounded, power-of-two capacity)
+// The owning worker pushes at the bottom; the owner and thieves take from the
+// top with a CAS, so tasks keep their arrival order. Elements must be
+// trivially copyable (task pointers): a thief may read a slot and then lose the
+// race for it, which is only safe if reading never touches shared state.
+template<typename T, size_t Size = 1024>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "store pointers or handles");
+    static_assert((Size & (Size - 1)) == 0, "Size must be a power of two");
+
+private:
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    std::atomic<T> buffer[Size];
+
+public:
+    // Owner only
+    bool push(T item) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= static_cast<int64_t>(Size)) {
+            return false; // Deque full
+        }
+        buffer[b & (Size - 1)].store(item, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Owner only: a stale top can only make the deque look fuller
+    bool full() const {
+        return bottom.load(std::memory_order_relaxed) -
+               top.load(std::memory_order_acquire) >= static_cast<int64_t>(Size);
+    }
+
+    // Any thread; only a hint while other threads are active
+    bool empty() const {
+        return bottom.load(std::memory_order_acquire) <= top.load(std::memory_order_acquire);
+    }
+
+    // Any thread, the owner included (its own takes cost the same fence and
+    // CAS as a thief's)
+    bool steal(T& item) {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return false; // Deque empty
+        }
+        T candidate = buffer[t & (Size - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1,
+                                         std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+            return false; // Lost the race to another thief (or the owner)
+        }
+        item = candidate;
+        return true;
+    }
+};